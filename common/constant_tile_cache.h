@@ -0,0 +1,217 @@
+#ifndef VSMLRT_COMMON_CONSTANT_TILE_CACHE_H_
+#define VSMLRT_COMMON_CONSTANT_TILE_CACHE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tiling.h"
+
+// Serves the output of tiles whose source is a single value per plane,
+// such as letterbox bars and flat backgrounds.
+//
+// The output of such a tile only depends on its shape and its values, so
+// the network runs once per distinct tile and the whole output tensor is
+// kept in a small least recently used cache. With zero padding, the valid
+// size of a padded tile is part of the key, since the padding is not of the
+// same value. Equal constant tiles of a frame that are not cached yet are
+// inferred once and unpacked after the inference of the frame.
+
+struct ConstantTileCache {
+    struct Key {
+        int shape;
+
+        // valid size of zero padded tiles
+        int src_w;
+        int src_h;
+
+        // the value of each plane
+        std::vector<uint8_t> values;
+
+        bool operator==(const Key & other) const noexcept {
+            return (
+                shape == other.shape && src_w == other.src_w && src_h == other.src_h &&
+                values == other.values
+            );
+        }
+    };
+
+    // number of cached outputs
+    int capacity;
+
+    // the constant tiles of a frame that are inferred
+    struct Pending {
+        struct Output {
+            Key key;
+            std::vector<uint8_t> tensor;
+        };
+        std::vector<Output> outputs;
+
+        // later tiles of a frame with the key of an inferred tile,
+        // indexed into `outputs`
+        std::vector<std::pair<TileJob, int>> deferred;
+    };
+
+    // Unpacks the cached output of the constant tiles of `jobs` and removes
+    // them from `jobs`, as well as repeated constant tiles that are inferred
+    // by `jobs` already. Returns the number of removed tiles.
+    int reuse(
+        const TilePlan & plan,
+        std::vector<TileJob> & jobs,
+        Pending & pending
+    ) noexcept {
+
+        int reused = 0;
+        auto kept = std::begin(jobs);
+        for (auto job : jobs) {
+            Key key;
+            if (!constantKey(plan, *job.tile, *job.io, key)) {
+                *kept++ = job;
+                continue;
+            }
+
+            auto output = std::find_if(
+                std::begin(pending.outputs), std::end(pending.outputs),
+                [&key](const auto & output) { return output.key == key; }
+            );
+            if (output != std::end(pending.outputs)) {
+                pending.deferred.emplace_back(job, static_cast<int>(output - std::begin(pending.outputs)));
+                ++reused;
+                continue;
+            }
+
+            std::shared_ptr<const std::vector<uint8_t>> tensor;
+            {
+                std::lock_guard lock { mutex };
+
+                auto entry = std::find_if(
+                    std::begin(entries), std::end(entries),
+                    [&key](const auto & entry) { return entry.key == key; }
+                );
+                if (entry != std::end(entries)) {
+                    entries.splice(std::begin(entries), entries, entry);
+                    tensor = entry->tensor;
+                }
+            }
+
+            if (tensor) {
+                unpackBatch(plan, &job, 1, std::data(*tensor));
+                ++reused;
+                continue;
+            }
+
+            pending.outputs.push_back({
+                std::move(key),
+                std::vector<uint8_t>(plan.shapes[job.tile->shape].dst_batch_stride)
+            });
+            job.output_copy = std::data(pending.outputs.back().tensor);
+            *kept++ = job;
+        }
+        jobs.erase(kept, std::end(jobs));
+
+        return reused;
+    }
+
+    // caches the outputs of the inferred constant tiles and unpacks the
+    // repeated ones
+    void finish(const TilePlan & plan, Pending & pending) noexcept {
+        for (const auto & [job, index] : pending.deferred) {
+            unpackBatch(plan, &job, 1, std::data(pending.outputs[index].tensor));
+        }
+
+        std::lock_guard lock { mutex };
+
+        for (auto & output : pending.outputs) {
+            if (std::none_of(
+                std::begin(entries), std::end(entries),
+                [&output](const auto & entry) { return entry.key == output.key; }
+            )) {
+                entries.push_front(Entry {
+                    std::move(output.key),
+                    std::make_shared<const std::vector<uint8_t>>(std::move(output.tensor))
+                });
+            }
+        }
+
+        while (static_cast<int>(std::size(entries)) > capacity) {
+            entries.pop_back();
+        }
+    }
+
+private:
+    struct Entry {
+        Key key;
+        std::shared_ptr<const std::vector<uint8_t>> tensor;
+    };
+
+    std::mutex mutex;
+    std::list<Entry> entries; // most recently used first
+
+    template <typename T>
+    static bool isConstant(const uint8_t * src, int stride, int width, int height) noexcept {
+        T value;
+        std::memcpy(&value, src, sizeof(T));
+
+        for (int y = 0; y < height; ++y) {
+            auto srcp = reinterpret_cast<const T *>(src + y * stride);
+            for (int x = 0; x < width; ++x) {
+                if (srcp[x] != value) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static bool constantKey(
+        const TilePlan & plan,
+        const Tile & tile,
+        const FrameIO & io,
+        Key & key
+    ) noexcept {
+
+        const int bytes = plan.src_format.bytes;
+        const size_t offset = (
+            static_cast<size_t>(tile.src_y) * io.src_stride +
+            static_cast<size_t>(tile.src_x) * bytes
+        );
+
+        key.values.resize(plan.src_planes * bytes);
+        for (int plane = 0; plane < plan.src_planes; ++plane) {
+            const uint8_t * srcp = io.src_ptrs[plane] + offset;
+
+            // compares the bits of float samples, so that -0 and nan are
+            // never merged with other values
+            bool constant;
+            if (bytes == 1) {
+                constant = isConstant<uint8_t>(srcp, io.src_stride, tile.src_w, tile.src_h);
+            } else if (bytes == 2) {
+                constant = isConstant<uint16_t>(srcp, io.src_stride, tile.src_w, tile.src_h);
+            } else {
+                constant = isConstant<uint32_t>(srcp, io.src_stride, tile.src_w, tile.src_h);
+            }
+            if (!constant) {
+                return false;
+            }
+
+            std::memcpy(&key.values[plane * bytes], srcp, bytes);
+        }
+
+        key.shape = tile.shape;
+        if (plan.padding == Padding::Zero && isPadded(plan, tile)) {
+            key.src_w = tile.src_w;
+            key.src_h = tile.src_h;
+        } else {
+            key.src_w = key.src_h = 0;
+        }
+
+        return true;
+    }
+};
+
+#endif // VSMLRT_COMMON_CONSTANT_TILE_CACHE_H_
@@ -298,8 +298,8 @@ static ONNX_NAMESPACE::ValueInfoProto make_value_info_from_tensor(
 
 void convert_float_to_float16(
     ONNX_NAMESPACE::ModelProto & model,
-    bool force_fp16_initializers
-    // , bool keep_io_types = True
+    bool force_fp16_initializers,
+    bool keep_io_types
     // , bool disable_shape_infer = True
     // , const std::optional<std::unordered_set<std::string>> op_block_list = DEFAULT_OP_BLOCK_LIST
     // , const std::optional<std::unordered_set<std::string>> op_block_list = {}
@@ -326,6 +326,10 @@ void convert_float_to_float16(
     const std::vector<std::string> fp32_inputs = [&]() {
         std::vector<std::string> ret {};
 
+        if (!keep_io_types) {
+            return ret;
+        }
+
         for (const auto & n : model.graph().input()) {
             if (n.type().tensor_type().elem_type() == ONNX_NAMESPACE::TensorProto::FLOAT) {
                 ret.emplace_back(n.name());
@@ -375,6 +379,10 @@ void convert_float_to_float16(
     const std::vector<std::string> fp32_outputs = [&]() {
         std::vector<std::string> ret {};
 
+        if (!keep_io_types) {
+            return ret;
+        }
+
         for (const auto & n : model.graph().output()) {
             if (n.type().tensor_type().elem_type() == ONNX_NAMESPACE::TensorProto::FLOAT) {
                 ret.emplace_back(n.name());
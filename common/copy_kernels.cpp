@@ -0,0 +1,228 @@
+#include <cstring>
+
+#if defined(VSMLRT_ENABLE_X86_KERNELS) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+#include "copy_kernels.h"
+
+#ifdef VSMLRT_ENABLE_X86_KERNELS
+extern const CopyKernels copy_kernels_avx2;
+extern const CopyKernels copy_kernels_avx512;
+#endif // VSMLRT_ENABLE_X86_KERNELS
+
+static void gather_c(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    size_t row_bytes, int height, int planes
+) noexcept {
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            std::memcpy(
+                dst + plane * dst_plane_bytes + y * dst_stride,
+                srcs[plane] + src_offset + y * src_stride,
+                row_bytes
+            );
+        }
+    }
+}
+
+static void scatter_c(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    size_t row_bytes, int height, int planes
+) noexcept {
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            std::memcpy(
+                dsts[plane] + dst_offset + y * dst_stride,
+                src + plane * src_plane_bytes + y * src_stride,
+                row_bytes
+            );
+        }
+    }
+}
+
+static void gather_int_c(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float scale = 1.f / static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            auto dstp = reinterpret_cast<float *>(dst + plane * dst_plane_bytes + y * dst_stride);
+            const uint8_t * srcp = srcs[plane] + src_offset + y * src_stride;
+
+            if (bytes == 1) {
+                normalizeRow(dstp, srcp, width, scale);
+            } else {
+                normalizeRow(dstp, reinterpret_cast<const uint16_t *>(srcp), width, scale);
+            }
+        }
+    }
+}
+
+static void scatter_int_c(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float peak = static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            uint8_t * dstp = dsts[plane] + dst_offset + y * dst_stride;
+            auto srcp = reinterpret_cast<const float *>(src + plane * src_plane_bytes + y * src_stride);
+
+            if (bytes == 1) {
+                quantizeRow(dstp, srcp, width, peak, peak);
+            } else {
+                quantizeRow(reinterpret_cast<uint16_t *>(dstp), srcp, width, peak, peak);
+            }
+        }
+    }
+}
+
+static void gather_half_c(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float scale = (bytes == 4) ? 1.f : 1.f / static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            auto dstp = reinterpret_cast<uint16_t *>(dst + plane * dst_plane_bytes + y * dst_stride);
+            const uint8_t * srcp = srcs[plane] + src_offset + y * src_stride;
+
+            if (bytes == 4) {
+                toHalfRow(dstp, reinterpret_cast<const float *>(srcp), width, scale);
+            } else if (bytes == 1) {
+                toHalfRow(dstp, srcp, width, scale);
+            } else {
+                toHalfRow(dstp, reinterpret_cast<const uint16_t *>(srcp), width, scale);
+            }
+        }
+    }
+}
+
+static void scatter_half_c(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float peak = (bytes == 4) ? 1.f : static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            uint8_t * dstp = dsts[plane] + dst_offset + y * dst_stride;
+            auto srcp = reinterpret_cast<const uint16_t *>(src + plane * src_plane_bytes + y * src_stride);
+
+            if (bytes == 4) {
+                fromHalfRow(reinterpret_cast<float *>(dstp), srcp, width, peak, peak);
+            } else if (bytes == 1) {
+                fromHalfRow(dstp, srcp, width, peak, peak);
+            } else {
+                fromHalfRow(reinterpret_cast<uint16_t *>(dstp), srcp, width, peak, peak);
+            }
+        }
+    }
+}
+
+static uint64_t hash_c(
+    const uint8_t * src, ptrdiff_t stride,
+    size_t row_bytes, int height, uint64_t seed
+) noexcept {
+
+    uint64_t acc[4];
+    hashInit(acc, seed);
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t * srcp = src + y * stride;
+
+        size_t x = 0;
+        for (; x + 32 <= row_bytes; x += 32) {
+            hashBlock(acc, srcp + x);
+        }
+        hashTail(acc, srcp + x, row_bytes - x);
+    }
+
+    return hashFinish(acc, row_bytes, height);
+}
+
+static const CopyKernels copy_kernels_c {
+    "c", gather_c, scatter_c, gather_int_c, scatter_int_c, gather_half_c, scatter_half_c,
+    hash_c
+};
+
+#ifdef VSMLRT_ENABLE_X86_KERNELS
+#ifdef _MSC_VER
+static bool cpuSupports(bool avx512) noexcept {
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    bool f16c = info[2] & (1 << 29);
+    if (!osxsave || !avx || !f16c) {
+        return false;
+    }
+
+    // the os must preserve the ymm (and zmm) registers
+    auto xcr0 = _xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    if (avx512) {
+        return (xcr0 & 0xe0) == 0xe0 && (info[1] & (1 << 16));
+    } else {
+        return info[1] & (1 << 5);
+    }
+}
+#else // _MSC_VER
+static bool cpuSupports(bool avx512) noexcept {
+    __builtin_cpu_init();
+
+    if (avx512) {
+        return __builtin_cpu_supports("avx512f");
+    } else {
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    }
+}
+#endif // _MSC_VER
+#endif // VSMLRT_ENABLE_X86_KERNELS
+
+static const CopyKernels & selectCopyKernels() noexcept {
+#ifdef VSMLRT_ENABLE_X86_KERNELS
+    if (cpuSupports(true)) {
+        return copy_kernels_avx512;
+    }
+
+    if (cpuSupports(false)) {
+        return copy_kernels_avx2;
+    }
+#endif // VSMLRT_ENABLE_X86_KERNELS
+
+    return copy_kernels_c;
+}
+
+const CopyKernels & getCopyKernels() noexcept {
+    static const CopyKernels & kernels = selectCopyKernels();
+    return kernels;
+}
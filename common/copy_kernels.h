@@ -0,0 +1,239 @@
+#ifndef VSMLRT_COMMON_COPY_KERNELS_H_
+#define VSMLRT_COMMON_COPY_KERNELS_H_
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Copy kernels between the planes of a frame and a NCHW tensor.
+//
+// All planes of a tile are handled row by row in one pass. Scatters that are
+// larger than `stream_threshold` bytes use non-temporal stores, so that the
+// output frame does not evict the tensors of the next tile from the caches.
+//
+// A hash of plane contents shares the dispatch, all implementations return
+// the same value.
+
+struct CopyKernels {
+    const char * name;
+
+    // copies the rows at `src_offset` of `planes` source planes into
+    // consecutive planes of a tensor
+    void (*gather)(
+        uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+        const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+        size_t row_bytes, int height, int planes
+    ) noexcept;
+
+    // copies the rows of consecutive planes of a tensor into
+    // `planes` destination planes at `dst_offset`
+    void (*scatter)(
+        uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+        const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+        size_t row_bytes, int height, int planes
+    ) noexcept;
+
+    // same as gather(), but converts `width` integer samples of `bytes` bytes
+    // to floats normalized by the maximum value of `bits`
+    void (*gather_int)(
+        uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+        const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+        int width, int height, int planes, int bytes, int bits
+    ) noexcept;
+
+    // same as scatter(), but quantizes `width` floats in [0, 1] to integers
+    // of `bytes` bytes with rounding and saturation
+    void (*scatter_int)(
+        uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+        const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+        int width, int height, int planes, int bytes, int bits
+    ) noexcept;
+
+    // same as gather(), but converts `width` samples to half floats,
+    // the samples are floats if `bytes` is 4 and integers otherwise
+    void (*gather_half)(
+        uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+        const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+        int width, int height, int planes, int bytes, int bits
+    ) noexcept;
+
+    // same as scatter(), but converts `width` half floats to floats if
+    // `bytes` is 4 and quantizes them to integers otherwise
+    void (*scatter_half)(
+        uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+        const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+        int width, int height, int planes, int bytes, int bits
+    ) noexcept;
+
+    // 64-bit hash of `height` rows of `row_bytes` bytes, chained by `seed`
+    uint64_t (*hash)(
+        const uint8_t * src, ptrdiff_t stride,
+        size_t row_bytes, int height, uint64_t seed
+    ) noexcept;
+};
+
+constexpr size_t stream_threshold = 1 << 20;
+
+// scalar conversions, also used for the tails of vectorized rows
+template <typename T>
+static inline
+void normalizeRow(float * dst, const T * src, int width, float scale) noexcept {
+    for (int x = 0; x < width; ++x) {
+        dst[x] = static_cast<float>(src[x]) * scale;
+    }
+}
+
+template <typename T>
+static inline
+void quantizeRow(T * dst, const float * src, int width, float scale, float peak) noexcept {
+    for (int x = 0; x < width; ++x) {
+        float v = src[x] * scale;
+        v = (v > 0.f) ? v : 0.f; // also maps nan to 0
+        v = (v < peak) ? v : peak;
+        dst[x] = static_cast<T>(std::lrint(v));
+    }
+}
+
+// IEEE 754 binary16 conversions with round to nearest even,
+// matching the results of F16C and AVX-512 instructions
+static inline
+uint16_t floatToHalf(float f) noexcept {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+
+    const uint32_t sign = (x >> 16) & 0x8000u;
+    x &= 0x7fffffffu;
+
+    // inf and nan, the latter stays quiet
+    if (x >= 0x7f800000u) {
+        uint32_t nan = (x > 0x7f800000u) ? (0x200u | ((x >> 13) & 0x3ffu)) : 0u;
+        return static_cast<uint16_t>(sign | 0x7c00u | nan);
+    }
+
+    // rounds to inf
+    if (x >= 0x477ff000u) {
+        return static_cast<uint16_t>(sign | 0x7c00u);
+    }
+
+    // subnormal results, rounded by the fp adder
+    if (x < 0x38800000u) {
+        float v;
+        std::memcpy(&v, &x, sizeof(v));
+        v += 0.5f;
+        std::memcpy(&x, &v, sizeof(x));
+        return static_cast<uint16_t>(sign | (x - 0x3f000000u));
+    }
+
+    const uint32_t odd = (x >> 13) & 1u;
+    x += 0xc8000fffu + odd; // rebias the exponent and round
+    return static_cast<uint16_t>(sign | (x >> 13));
+}
+
+static inline
+float halfToFloat(uint16_t h) noexcept {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    const uint32_t em = h & 0x7fffu;
+
+    uint32_t x;
+    if (em >= 0x7c00u) {
+        uint32_t nan = (em > 0x7c00u) ? 0x400000u : 0u;
+        x = 0x7f800000u | nan | ((em & 0x3ffu) << 13);
+    } else if (em >= 0x400u) {
+        x = (em << 13) + 0x38000000u;
+    } else {
+        float v = static_cast<float>(em) * 0x1p-24f;
+        std::memcpy(&x, &v, sizeof(x));
+    }
+    x |= sign;
+
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+template <typename T>
+static inline
+void toHalfRow(uint16_t * dst, const T * src, int width, float scale) noexcept {
+    for (int x = 0; x < width; ++x) {
+        dst[x] = floatToHalf(static_cast<float>(src[x]) * scale);
+    }
+}
+
+template <typename T>
+static inline
+void fromHalfRow(T * dst, const uint16_t * src, int width, float scale, float peak) noexcept {
+    if constexpr (std::is_floating_point_v<T>) {
+        for (int x = 0; x < width; ++x) {
+            dst[x] = halfToFloat(src[x]);
+        }
+    } else {
+        for (int x = 0; x < width; ++x) {
+            float v = halfToFloat(src[x]) * scale;
+            v = (v > 0.f) ? v : 0.f;
+            v = (v < peak) ? v : peak;
+            dst[x] = static_cast<T>(std::lrint(v));
+        }
+    }
+}
+
+// The hash keeps four 64-bit lanes that consume 32-byte blocks of a row,
+// a block is zero padded at the end of a row. The lane i of a block is
+// (v & 0xffffffff) * (v >> 32) + w[i ^ 1] with v = w[i] ^ hash_keys[i],
+// which maps to the 32-bit multiplies of SIMD instruction sets.
+constexpr uint64_t hash_keys[4] {
+    0x9e3779b185ebca87u, 0xc2b2ae3d27d4eb4fu, 0x165667b19e3779f9u, 0x85ebca77c2b2ae63u
+};
+
+static inline
+void hashBlock(uint64_t * acc, const uint8_t * src) noexcept {
+    uint64_t w[4];
+    std::memcpy(w, src, sizeof(w));
+
+    for (int i = 0; i < 4; ++i) {
+        uint64_t v = w[i] ^ hash_keys[i];
+        acc[i] += (v & 0xffffffffu) * (v >> 32) + w[i ^ 1];
+    }
+}
+
+static inline
+uint64_t hashMix(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdu;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53u;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline
+void hashInit(uint64_t * acc, uint64_t seed) noexcept {
+    for (int i = 0; i < 4; ++i) {
+        acc[i] = seed + hash_keys[i];
+    }
+}
+
+static inline
+uint64_t hashFinish(const uint64_t * acc, size_t row_bytes, int height) noexcept {
+    uint64_t h = hashMix(static_cast<uint64_t>(row_bytes) * static_cast<uint64_t>(height));
+    for (int i = 0; i < 4; ++i) {
+        h = (h ^ hashMix(acc[i])) * 0x9e3779b185ebca87u;
+    }
+    return hashMix(h);
+}
+
+// the tail of a row shorter than a block
+static inline
+void hashTail(uint64_t * acc, const uint8_t * src, size_t bytes) noexcept {
+    if (bytes > 0) {
+        uint8_t block[32] {};
+        std::memcpy(block, src, bytes);
+        hashBlock(acc, block);
+    }
+}
+
+// the fastest kernels supported by the running cpu
+const CopyKernels & getCopyKernels() noexcept;
+
+#endif // VSMLRT_COMMON_COPY_KERNELS_H_
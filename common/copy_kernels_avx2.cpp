@@ -0,0 +1,394 @@
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "copy_kernels.h"
+
+static inline
+void copyRow(uint8_t * dst, const uint8_t * src, size_t bytes) noexcept {
+    size_t x = 0;
+
+    for (; x + 128 <= bytes; x += 128) {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x + 32));
+        __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x + 64));
+        __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x + 96));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), v0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x + 32), v1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x + 64), v2);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x + 96), v3);
+    }
+
+    for (; x + 32 <= bytes; x += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), v);
+    }
+
+    std::memcpy(dst + x, src + x, bytes - x);
+}
+
+// the destination is written with non-temporal stores once it is aligned
+static inline
+void streamRow(uint8_t * dst, const uint8_t * src, size_t bytes) noexcept {
+    size_t head = (32 - (reinterpret_cast<uintptr_t>(dst) & 31)) & 31;
+    if (head >= bytes) {
+        std::memcpy(dst, src, bytes);
+        return;
+    }
+    std::memcpy(dst, src, head);
+
+    size_t x = head;
+
+    for (; x + 128 <= bytes; x += 128) {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x + 32));
+        __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x + 64));
+        __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + x), v0);
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + x + 32), v1);
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + x + 64), v2);
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + x + 96), v3);
+    }
+
+    for (; x + 32 <= bytes; x += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + x), v);
+    }
+
+    std::memcpy(dst + x, src + x, bytes - x);
+}
+
+static void gather_avx2(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    size_t row_bytes, int height, int planes
+) noexcept {
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            const uint8_t * src = srcs[plane] + src_offset + y * src_stride;
+            _mm_prefetch(reinterpret_cast<const char *>(src + src_stride), _MM_HINT_T0);
+            copyRow(dst + plane * dst_plane_bytes + y * dst_stride, src, row_bytes);
+        }
+    }
+}
+
+static void scatter_avx2(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    size_t row_bytes, int height, int planes
+) noexcept {
+
+    if (row_bytes * height * planes < stream_threshold) {
+        for (int y = 0; y < height; ++y) {
+            for (int plane = 0; plane < planes; ++plane) {
+                copyRow(
+                    dsts[plane] + dst_offset + y * dst_stride,
+                    src + plane * src_plane_bytes + y * src_stride,
+                    row_bytes
+                );
+            }
+        }
+        return;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            streamRow(
+                dsts[plane] + dst_offset + y * dst_stride,
+                src + plane * src_plane_bytes + y * src_stride,
+                row_bytes
+            );
+        }
+    }
+
+    _mm_sfence();
+}
+
+static inline
+void normalizeRowU8(float * dst, const uint8_t * src, int width, float scale) noexcept {
+    const __m256 vscale = _mm256_set1_ps(scale);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + x));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+        _mm256_storeu_ps(dst + x, _mm256_mul_ps(f, vscale));
+    }
+
+    normalizeRow(dst + x, src + x, width - x, scale);
+}
+
+static inline
+void normalizeRowU16(float * dst, const uint16_t * src, int width, float scale) noexcept {
+    const __m256 vscale = _mm256_set1_ps(scale);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v));
+        _mm256_storeu_ps(dst + x, _mm256_mul_ps(f, vscale));
+    }
+
+    normalizeRow(dst + x, src + x, width - x, scale);
+}
+
+// 8 rounded and clamped samples as unsigned 16-bit integers
+static inline
+__m128i quantize8(__m256 v, __m256 vscale, __m256 vpeak) noexcept {
+    v = _mm256_mul_ps(v, vscale);
+    v = _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), vpeak);
+    __m256i i = _mm256_cvtps_epi32(v);
+    return _mm_packus_epi32(_mm256_castsi256_si128(i), _mm256_extracti128_si256(i, 1));
+}
+
+static inline
+void quantizeRowU8(uint8_t * dst, const float * src, int width, float scale, float peak) noexcept {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 vpeak = _mm256_set1_ps(peak);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = quantize8(_mm256_loadu_ps(src + x), vscale, vpeak);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(v, v));
+    }
+
+    quantizeRow(dst + x, src + x, width - x, scale, peak);
+}
+
+static inline
+void quantizeRowU16(uint16_t * dst, const float * src, int width, float scale, float peak) noexcept {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 vpeak = _mm256_set1_ps(peak);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), quantize8(_mm256_loadu_ps(src + x), vscale, vpeak));
+    }
+
+    quantizeRow(dst + x, src + x, width - x, scale, peak);
+}
+
+static void gather_int_avx2(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float scale = 1.f / static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            auto dstp = reinterpret_cast<float *>(dst + plane * dst_plane_bytes + y * dst_stride);
+            const uint8_t * srcp = srcs[plane] + src_offset + y * src_stride;
+            _mm_prefetch(reinterpret_cast<const char *>(srcp + src_stride), _MM_HINT_T0);
+
+            if (bytes == 1) {
+                normalizeRowU8(dstp, srcp, width, scale);
+            } else {
+                normalizeRowU16(dstp, reinterpret_cast<const uint16_t *>(srcp), width, scale);
+            }
+        }
+    }
+}
+
+static void scatter_int_avx2(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float peak = static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            uint8_t * dstp = dsts[plane] + dst_offset + y * dst_stride;
+            auto srcp = reinterpret_cast<const float *>(src + plane * src_plane_bytes + y * src_stride);
+
+            if (bytes == 1) {
+                quantizeRowU8(dstp, srcp, width, peak, peak);
+            } else {
+                quantizeRowU16(reinterpret_cast<uint16_t *>(dstp), srcp, width, peak, peak);
+            }
+        }
+    }
+}
+
+static inline
+void storeHalf8(uint16_t * dst, __m256 v) noexcept {
+    __m128i h = _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), h);
+}
+
+static inline
+__m256 loadHalf8(const uint16_t * src) noexcept {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+}
+
+static inline
+void toHalfRowF32(uint16_t * dst, const float * src, int width) noexcept {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        storeHalf8(dst + x, _mm256_loadu_ps(src + x));
+    }
+
+    toHalfRow(dst + x, src + x, width - x, 1.f);
+}
+
+static inline
+void toHalfRowU8(uint16_t * dst, const uint8_t * src, int width, float scale) noexcept {
+    const __m256 vscale = _mm256_set1_ps(scale);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + x));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+        storeHalf8(dst + x, _mm256_mul_ps(f, vscale));
+    }
+
+    toHalfRow(dst + x, src + x, width - x, scale);
+}
+
+static inline
+void toHalfRowU16(uint16_t * dst, const uint16_t * src, int width, float scale) noexcept {
+    const __m256 vscale = _mm256_set1_ps(scale);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v));
+        storeHalf8(dst + x, _mm256_mul_ps(f, vscale));
+    }
+
+    toHalfRow(dst + x, src + x, width - x, scale);
+}
+
+static inline
+void fromHalfRowF32(float * dst, const uint16_t * src, int width) noexcept {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        _mm256_storeu_ps(dst + x, loadHalf8(src + x));
+    }
+
+    fromHalfRow(dst + x, src + x, width - x, 1.f, 1.f);
+}
+
+static inline
+void fromHalfRowU8(uint8_t * dst, const uint16_t * src, int width, float scale, float peak) noexcept {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 vpeak = _mm256_set1_ps(peak);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = quantize8(loadHalf8(src + x), vscale, vpeak);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(v, v));
+    }
+
+    fromHalfRow(dst + x, src + x, width - x, scale, peak);
+}
+
+static inline
+void fromHalfRowU16(uint16_t * dst, const uint16_t * src, int width, float scale, float peak) noexcept {
+    const __m256 vscale = _mm256_set1_ps(scale);
+    const __m256 vpeak = _mm256_set1_ps(peak);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), quantize8(loadHalf8(src + x), vscale, vpeak));
+    }
+
+    fromHalfRow(dst + x, src + x, width - x, scale, peak);
+}
+
+static void gather_half_avx2(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float scale = (bytes == 4) ? 1.f : 1.f / static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            auto dstp = reinterpret_cast<uint16_t *>(dst + plane * dst_plane_bytes + y * dst_stride);
+            const uint8_t * srcp = srcs[plane] + src_offset + y * src_stride;
+            _mm_prefetch(reinterpret_cast<const char *>(srcp + src_stride), _MM_HINT_T0);
+
+            if (bytes == 4) {
+                toHalfRowF32(dstp, reinterpret_cast<const float *>(srcp), width);
+            } else if (bytes == 1) {
+                toHalfRowU8(dstp, srcp, width, scale);
+            } else {
+                toHalfRowU16(dstp, reinterpret_cast<const uint16_t *>(srcp), width, scale);
+            }
+        }
+    }
+}
+
+static void scatter_half_avx2(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float peak = (bytes == 4) ? 1.f : static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            uint8_t * dstp = dsts[plane] + dst_offset + y * dst_stride;
+            auto srcp = reinterpret_cast<const uint16_t *>(src + plane * src_plane_bytes + y * src_stride);
+
+            if (bytes == 4) {
+                fromHalfRowF32(reinterpret_cast<float *>(dstp), srcp, width);
+            } else if (bytes == 1) {
+                fromHalfRowU8(dstp, srcp, width, peak, peak);
+            } else {
+                fromHalfRowU16(reinterpret_cast<uint16_t *>(dstp), srcp, width, peak, peak);
+            }
+        }
+    }
+}
+
+static inline
+__m256i hashBlock8(__m256i acc, const uint8_t * src, __m256i keys) noexcept {
+    __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    __m256i v = _mm256_xor_si256(w, keys);
+    __m256i product = _mm256_mul_epu32(v, _mm256_srli_epi64(v, 32));
+    __m256i swapped = _mm256_shuffle_epi32(w, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_add_epi64(acc, _mm256_add_epi64(product, swapped));
+}
+
+static uint64_t hash_avx2(
+    const uint8_t * src, ptrdiff_t stride,
+    size_t row_bytes, int height, uint64_t seed
+) noexcept {
+
+    alignas(32) uint64_t acc[4];
+    hashInit(acc, seed);
+
+    const __m256i keys = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hash_keys));
+    __m256i vacc = _mm256_load_si256(reinterpret_cast<const __m256i *>(acc));
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t * srcp = src + y * stride;
+
+        size_t x = 0;
+        for (; x + 32 <= row_bytes; x += 32) {
+            vacc = hashBlock8(vacc, srcp + x, keys);
+        }
+
+        if (x < row_bytes) {
+            alignas(32) uint8_t block[32] {};
+            std::memcpy(block, srcp + x, row_bytes - x);
+            vacc = hashBlock8(vacc, block, keys);
+        }
+    }
+
+    _mm256_store_si256(reinterpret_cast<__m256i *>(acc), vacc);
+    return hashFinish(acc, row_bytes, height);
+}
+
+extern const CopyKernels copy_kernels_avx2 {
+    "avx2", gather_avx2, scatter_avx2, gather_int_avx2, scatter_int_avx2,
+    gather_half_avx2, scatter_half_avx2, hash_avx2
+};
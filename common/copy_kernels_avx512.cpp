@@ -0,0 +1,406 @@
+#include <cstring>
+
+#include <immintrin.h>
+
+#include "copy_kernels.h"
+
+static inline
+void copyRow(uint8_t * dst, const uint8_t * src, size_t bytes) noexcept {
+    size_t x = 0;
+
+    for (; x + 256 <= bytes; x += 256) {
+        __m512i v0 = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x));
+        __m512i v1 = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x + 64));
+        __m512i v2 = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x + 128));
+        __m512i v3 = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x + 192));
+        _mm512_storeu_si512(reinterpret_cast<__m512i *>(dst + x), v0);
+        _mm512_storeu_si512(reinterpret_cast<__m512i *>(dst + x + 64), v1);
+        _mm512_storeu_si512(reinterpret_cast<__m512i *>(dst + x + 128), v2);
+        _mm512_storeu_si512(reinterpret_cast<__m512i *>(dst + x + 192), v3);
+    }
+
+    for (; x + 64 <= bytes; x += 64) {
+        __m512i v = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x));
+        _mm512_storeu_si512(reinterpret_cast<__m512i *>(dst + x), v);
+    }
+
+    std::memcpy(dst + x, src + x, bytes - x);
+}
+
+// the destination is written with non-temporal stores once it is aligned
+static inline
+void streamRow(uint8_t * dst, const uint8_t * src, size_t bytes) noexcept {
+    size_t head = (64 - (reinterpret_cast<uintptr_t>(dst) & 63)) & 63;
+    if (head >= bytes) {
+        std::memcpy(dst, src, bytes);
+        return;
+    }
+    std::memcpy(dst, src, head);
+
+    size_t x = head;
+
+    for (; x + 256 <= bytes; x += 256) {
+        __m512i v0 = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x));
+        __m512i v1 = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x + 64));
+        __m512i v2 = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x + 128));
+        __m512i v3 = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x + 192));
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + x), v0);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + x + 64), v1);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + x + 128), v2);
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + x + 192), v3);
+    }
+
+    for (; x + 64 <= bytes; x += 64) {
+        __m512i v = _mm512_loadu_si512(reinterpret_cast<const __m512i *>(src + x));
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst + x), v);
+    }
+
+    std::memcpy(dst + x, src + x, bytes - x);
+}
+
+static void gather_avx512(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    size_t row_bytes, int height, int planes
+) noexcept {
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            const uint8_t * src = srcs[plane] + src_offset + y * src_stride;
+            _mm_prefetch(reinterpret_cast<const char *>(src + src_stride), _MM_HINT_T0);
+            copyRow(dst + plane * dst_plane_bytes + y * dst_stride, src, row_bytes);
+        }
+    }
+}
+
+static void scatter_avx512(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    size_t row_bytes, int height, int planes
+) noexcept {
+
+    if (row_bytes * height * planes < stream_threshold) {
+        for (int y = 0; y < height; ++y) {
+            for (int plane = 0; plane < planes; ++plane) {
+                copyRow(
+                    dsts[plane] + dst_offset + y * dst_stride,
+                    src + plane * src_plane_bytes + y * src_stride,
+                    row_bytes
+                );
+            }
+        }
+        return;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            streamRow(
+                dsts[plane] + dst_offset + y * dst_stride,
+                src + plane * src_plane_bytes + y * src_stride,
+                row_bytes
+            );
+        }
+    }
+
+    _mm_sfence();
+}
+
+static inline
+void normalizeRowU8(float * dst, const uint8_t * src, int width, float scale) noexcept {
+    const __m512 vscale = _mm512_set1_ps(scale);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m512 f = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(v));
+        _mm512_storeu_ps(dst + x, _mm512_mul_ps(f, vscale));
+    }
+
+    normalizeRow(dst + x, src + x, width - x, scale);
+}
+
+static inline
+void normalizeRowU16(float * dst, const uint16_t * src, int width, float scale) noexcept {
+    const __m512 vscale = _mm512_set1_ps(scale);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        __m512 f = _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(v));
+        _mm512_storeu_ps(dst + x, _mm512_mul_ps(f, vscale));
+    }
+
+    normalizeRow(dst + x, src + x, width - x, scale);
+}
+
+// 16 rounded and clamped samples as 32-bit integers
+static inline
+__m512i quantize16(__m512 v, __m512 vscale, __m512 vpeak) noexcept {
+    v = _mm512_mul_ps(v, vscale);
+    v = _mm512_min_ps(_mm512_max_ps(v, _mm512_setzero_ps()), vpeak);
+    return _mm512_cvtps_epi32(v);
+}
+
+static inline
+void quantizeRowU8(uint8_t * dst, const float * src, int width, float scale, float peak) noexcept {
+    const __m512 vscale = _mm512_set1_ps(scale);
+    const __m512 vpeak = _mm512_set1_ps(peak);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm512_cvtusepi32_epi8(quantize16(_mm512_loadu_ps(src + x), vscale, vpeak));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), v);
+    }
+
+    quantizeRow(dst + x, src + x, width - x, scale, peak);
+}
+
+static inline
+void quantizeRowU16(uint16_t * dst, const float * src, int width, float scale, float peak) noexcept {
+    const __m512 vscale = _mm512_set1_ps(scale);
+    const __m512 vpeak = _mm512_set1_ps(peak);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm512_cvtusepi32_epi16(quantize16(_mm512_loadu_ps(src + x), vscale, vpeak));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), v);
+    }
+
+    quantizeRow(dst + x, src + x, width - x, scale, peak);
+}
+
+static void gather_int_avx512(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float scale = 1.f / static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            auto dstp = reinterpret_cast<float *>(dst + plane * dst_plane_bytes + y * dst_stride);
+            const uint8_t * srcp = srcs[plane] + src_offset + y * src_stride;
+            _mm_prefetch(reinterpret_cast<const char *>(srcp + src_stride), _MM_HINT_T0);
+
+            if (bytes == 1) {
+                normalizeRowU8(dstp, srcp, width, scale);
+            } else {
+                normalizeRowU16(dstp, reinterpret_cast<const uint16_t *>(srcp), width, scale);
+            }
+        }
+    }
+}
+
+static void scatter_int_avx512(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float peak = static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            uint8_t * dstp = dsts[plane] + dst_offset + y * dst_stride;
+            auto srcp = reinterpret_cast<const float *>(src + plane * src_plane_bytes + y * src_stride);
+
+            if (bytes == 1) {
+                quantizeRowU8(dstp, srcp, width, peak, peak);
+            } else {
+                quantizeRowU16(reinterpret_cast<uint16_t *>(dstp), srcp, width, peak, peak);
+            }
+        }
+    }
+}
+
+static inline
+void storeHalf16(uint16_t * dst, __m512 v) noexcept {
+    __m256i h = _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), h);
+}
+
+static inline
+__m512 loadHalf16(const uint16_t * src) noexcept {
+    return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)));
+}
+
+static inline
+void toHalfRowF32(uint16_t * dst, const float * src, int width) noexcept {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        storeHalf16(dst + x, _mm512_loadu_ps(src + x));
+    }
+
+    toHalfRow(dst + x, src + x, width - x, 1.f);
+}
+
+static inline
+void toHalfRowU8(uint16_t * dst, const uint8_t * src, int width, float scale) noexcept {
+    const __m512 vscale = _mm512_set1_ps(scale);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        __m512 f = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(v));
+        storeHalf16(dst + x, _mm512_mul_ps(f, vscale));
+    }
+
+    toHalfRow(dst + x, src + x, width - x, scale);
+}
+
+static inline
+void toHalfRowU16(uint16_t * dst, const uint16_t * src, int width, float scale) noexcept {
+    const __m512 vscale = _mm512_set1_ps(scale);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        __m512 f = _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(v));
+        storeHalf16(dst + x, _mm512_mul_ps(f, vscale));
+    }
+
+    toHalfRow(dst + x, src + x, width - x, scale);
+}
+
+static inline
+void fromHalfRowF32(float * dst, const uint16_t * src, int width) noexcept {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        _mm512_storeu_ps(dst + x, loadHalf16(src + x));
+    }
+
+    fromHalfRow(dst + x, src + x, width - x, 1.f, 1.f);
+}
+
+static inline
+void fromHalfRowU8(uint8_t * dst, const uint16_t * src, int width, float scale, float peak) noexcept {
+    const __m512 vscale = _mm512_set1_ps(scale);
+    const __m512 vpeak = _mm512_set1_ps(peak);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm512_cvtusepi32_epi8(quantize16(loadHalf16(src + x), vscale, vpeak));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), v);
+    }
+
+    fromHalfRow(dst + x, src + x, width - x, scale, peak);
+}
+
+static inline
+void fromHalfRowU16(uint16_t * dst, const uint16_t * src, int width, float scale, float peak) noexcept {
+    const __m512 vscale = _mm512_set1_ps(scale);
+    const __m512 vpeak = _mm512_set1_ps(peak);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm512_cvtusepi32_epi16(quantize16(loadHalf16(src + x), vscale, vpeak));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), v);
+    }
+
+    fromHalfRow(dst + x, src + x, width - x, scale, peak);
+}
+
+static void gather_half_avx512(
+    uint8_t * dst, size_t dst_stride, size_t dst_plane_bytes,
+    const uint8_t * const * srcs, size_t src_offset, ptrdiff_t src_stride,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float scale = (bytes == 4) ? 1.f : 1.f / static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            auto dstp = reinterpret_cast<uint16_t *>(dst + plane * dst_plane_bytes + y * dst_stride);
+            const uint8_t * srcp = srcs[plane] + src_offset + y * src_stride;
+            _mm_prefetch(reinterpret_cast<const char *>(srcp + src_stride), _MM_HINT_T0);
+
+            if (bytes == 4) {
+                toHalfRowF32(dstp, reinterpret_cast<const float *>(srcp), width);
+            } else if (bytes == 1) {
+                toHalfRowU8(dstp, srcp, width, scale);
+            } else {
+                toHalfRowU16(dstp, reinterpret_cast<const uint16_t *>(srcp), width, scale);
+            }
+        }
+    }
+}
+
+static void scatter_half_avx512(
+    uint8_t * const * dsts, size_t dst_offset, ptrdiff_t dst_stride,
+    const uint8_t * src, size_t src_stride, size_t src_plane_bytes,
+    int width, int height, int planes, int bytes, int bits
+) noexcept {
+
+    const float peak = (bytes == 4) ? 1.f : static_cast<float>((1 << bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int plane = 0; plane < planes; ++plane) {
+            uint8_t * dstp = dsts[plane] + dst_offset + y * dst_stride;
+            auto srcp = reinterpret_cast<const uint16_t *>(src + plane * src_plane_bytes + y * src_stride);
+
+            if (bytes == 4) {
+                fromHalfRowF32(reinterpret_cast<float *>(dstp), srcp, width);
+            } else if (bytes == 1) {
+                fromHalfRowU8(dstp, srcp, width, peak, peak);
+            } else {
+                fromHalfRowU16(reinterpret_cast<uint16_t *>(dstp), srcp, width, peak, peak);
+            }
+        }
+    }
+}
+
+// two 32-byte blocks per step, lanes 4-7 are folded into lanes 0-3 at the end
+static inline
+__m512i hashBlock16(__m512i acc, __m512i w, __m512i keys) noexcept {
+    __m512i v = _mm512_xor_si512(w, keys);
+    __m512i product = _mm512_mul_epu32(v, _mm512_srli_epi64(v, 32));
+    __m512i swapped = _mm512_shuffle_epi32(w, _MM_PERM_BADC);
+    return _mm512_add_epi64(acc, _mm512_add_epi64(product, swapped));
+}
+
+static uint64_t hash_avx512(
+    const uint8_t * src, ptrdiff_t stride,
+    size_t row_bytes, int height, uint64_t seed
+) noexcept {
+
+    alignas(64) uint64_t acc[8] {};
+    hashInit(acc, seed);
+
+    const __m512i keys = _mm512_broadcast_i64x4(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hash_keys))
+    );
+    __m512i vacc = _mm512_load_si512(acc);
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t * srcp = src + y * stride;
+
+        size_t x = 0;
+        for (; x + 64 <= row_bytes; x += 64) {
+            vacc = hashBlock16(vacc, _mm512_loadu_si512(srcp + x), keys);
+        }
+
+        if (size_t tail = row_bytes - x; tail > 0) {
+            alignas(64) uint8_t block[64] {};
+            std::memcpy(block, srcp + x, tail);
+
+            // a tail of at most one block only updates lanes 0-3
+            __mmask8 lanes = (tail > 32) ? 0xff : 0x0f;
+            vacc = _mm512_mask_mov_epi64(
+                vacc, lanes, hashBlock16(vacc, _mm512_load_si512(block), keys)
+            );
+        }
+    }
+
+    _mm512_store_si512(acc, vacc);
+    for (int i = 0; i < 4; ++i) {
+        acc[i] += acc[i + 4];
+    }
+
+    return hashFinish(acc, row_bytes, height);
+}
+
+extern const CopyKernels copy_kernels_avx512 {
+    "avx512", gather_avx512, scatter_avx512, gather_int_avx512, scatter_int_avx512,
+    gather_half_avx512, scatter_half_avx512, hash_avx512
+};
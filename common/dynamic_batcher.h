@@ -0,0 +1,107 @@
+#ifndef VSMLRT_COMMON_DYNAMIC_BATCHER_H_
+#define VSMLRT_COMMON_DYNAMIC_BATCHER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "tiling.h"
+
+// Merges tiles of frames that are processed concurrently into shared batches.
+//
+// There is no dedicated worker thread. Every frame enqueues its tiles and then
+// waits until all of them are inferred. Whenever a full batch is queued or the
+// oldest queued tile exceeds its deadline, one of the waiting threads takes up
+// to `max_batch` tiles of the same shape, regardless of their owners,
+// and runs them.
+
+struct DynamicBatcher {
+    std::vector<int> max_batch; // per tile shape
+    std::chrono::microseconds timeout;
+
+    // fn(const TileJob * jobs, int count) -> std::optional<std::string>
+    template <typename F>
+    [[nodiscard]]
+    std::optional<std::string> process(
+        const std::vector<TileJob> & frame_jobs,
+        F && fn
+    ) noexcept {
+
+        FrameState state { static_cast<int>(std::size(frame_jobs)), {} };
+
+        std::unique_lock lock { mutex };
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (const auto & job : frame_jobs) {
+            pending.push_back(PendingJob { job, &state, deadline });
+        }
+        cv.notify_all();
+
+        std::vector<TileJob> jobs;
+        std::vector<FrameState *> owners;
+
+        while (state.remaining > 0) {
+            if (std::empty(pending)) {
+                cv.wait(lock);
+                continue;
+            }
+
+            const int shape = pending.front().job.tile->shape;
+            const int shape_batch = max_batch[shape];
+
+            if (static_cast<int>(std::size(pending)) < shape_batch &&
+                std::chrono::steady_clock::now() < pending.front().deadline
+            ) {
+                cv.wait_until(lock, pending.front().deadline);
+                continue;
+            }
+
+            jobs.clear();
+            owners.clear();
+            while (static_cast<int>(std::size(jobs)) < shape_batch && !std::empty(pending) &&
+                pending.front().job.tile->shape == shape
+            ) {
+                jobs.push_back(pending.front().job);
+                owners.push_back(pending.front().owner);
+                pending.pop_front();
+            }
+            const int count = static_cast<int>(std::size(jobs));
+
+            lock.unlock();
+            auto err = fn(std::data(jobs), count);
+            lock.lock();
+
+            for (const auto & owner : owners) {
+                if (err.has_value() && !owner->error.has_value()) {
+                    owner->error = err;
+                }
+                --owner->remaining;
+            }
+            cv.notify_all();
+        }
+
+        return state.error;
+    }
+
+private:
+    struct FrameState {
+        int remaining;
+        std::optional<std::string> error;
+    };
+
+    struct PendingJob {
+        TileJob job;
+        FrameState * owner;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<PendingJob> pending;
+};
+
+#endif // VSMLRT_COMMON_DYNAMIC_BATCHER_H_
@@ -0,0 +1,270 @@
+#ifndef VSMLRT_COMMON_FRAME_DEDUPLICATOR_H_
+#define VSMLRT_COMMON_FRAME_DEDUPLICATOR_H_
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <VapourSynth.h>
+
+#include "copy_kernels.h"
+#include "tiling.h"
+
+// whether the rows of two planes are bitwise equal
+static inline
+bool planesEqual(
+    const uint8_t * lhs, ptrdiff_t lhs_stride,
+    const uint8_t * rhs, ptrdiff_t rhs_stride,
+    size_t row_bytes, int height
+) noexcept {
+
+    for (int y = 0; y < height; ++y) {
+        if (std::memcmp(lhs + y * lhs_stride, rhs + y * rhs_stride, row_bytes) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// whether no normalized samples of two planes differ by more than `threshold`
+static inline
+bool planesSimilar(
+    const uint8_t * lhs, ptrdiff_t lhs_stride,
+    const uint8_t * rhs, ptrdiff_t rhs_stride,
+    int width, int height,
+    const SampleFormat & format, float threshold
+) noexcept {
+
+    float scale = format.is_float ? 1.f : 1.f / static_cast<float>((1 << format.bits) - 1);
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t * lhsp = lhs + y * lhs_stride;
+        const uint8_t * rhsp = rhs + y * rhs_stride;
+
+        for (int x = 0; x < width; ++x) {
+            float diff = std::fabs(
+                normalizedSample(lhsp, x, format, scale) -
+                normalizedSample(rhsp, x, format, scale)
+            );
+
+            // also rejects nan
+            if (!(diff <= threshold)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Reuses the output of a recently processed frame whose sources are equal.
+//
+// Sources are matched by a hash of all of their planes followed by an exact
+// comparison, or, with a positive threshold, by the largest absolute
+// difference of normalized samples. A frame that matches a frame which is
+// still being processed waits for its output instead of running inference.
+// The sources of an entry never change and are freed with the last
+// reference to it, so they are compared without holding the lock.
+
+struct FrameDeduplicator {
+    struct Entry {
+        const VSAPI * vsapi;
+        uint64_t hash;
+        std::vector<const VSFrameRef *> sources;
+
+        // null while pending, guarded by the mutex
+        const VSFrameRef * output {};
+        bool failed {};
+
+        ~Entry() {
+            for (const auto & frame : sources) {
+                vsapi->freeFrame(frame);
+            }
+            vsapi->freeFrame(output);
+        }
+    };
+
+    // number of remembered frames
+    int capacity;
+
+    // 0: exact comparison
+    float threshold;
+
+    // Returns a new reference to the output of a matching frame. Otherwise
+    // registers the frame as pending in `pending`, which has to be finished
+    // by `finish()`, and returns null.
+    const VSFrameRef * acquire(
+        const std::vector<const VSFrameRef *> & sources,
+        std::shared_ptr<Entry> & pending,
+        const VSAPI * vsapi
+    ) noexcept {
+
+        uint64_t hash = (threshold > 0.f) ? 0 : hashFrames(sources, vsapi);
+
+        std::unique_lock lock { mutex };
+
+        while (true) {
+            // failed entries are removed at once, and the references keep
+            // the sources of evicted candidates alive. Two equal frames
+            // that arrive together may both be processed.
+            std::vector<std::shared_ptr<Entry>> candidates(std::rbegin(entries), std::rend(entries));
+
+            lock.unlock();
+            std::shared_ptr<Entry> match;
+            for (const auto & entry : candidates) {
+                if (threshold > 0.f) {
+                    if (isSimilar(entry->sources, sources, vsapi)) {
+                        match = entry;
+                        break;
+                    }
+                } else if (entry->hash == hash && isEqual(entry->sources, sources, vsapi)) {
+                    match = entry;
+                    break;
+                }
+            }
+            lock.lock();
+
+            if (!match) {
+                break;
+            }
+
+            while (!match->output && !match->failed) {
+                cv.wait(lock);
+            }
+
+            if (match->output) {
+                return vsapi->cloneFrameRef(match->output);
+            }
+        }
+
+        pending = std::make_shared<Entry>();
+        pending->vsapi = vsapi;
+        pending->hash = hash;
+        for (const auto & frame : sources) {
+            pending->sources.push_back(vsapi->cloneFrameRef(frame));
+        }
+        entries.push_back(pending);
+
+        // pending frames are never evicted, evicted entries keep their
+        // output for the frames that already matched them
+        for (auto it = std::begin(entries);
+            static_cast<int>(std::size(entries)) > capacity && it != std::end(entries);
+        ) {
+            if ((*it)->output) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // `output` is null if the frame failed
+    void finish(
+        const std::shared_ptr<Entry> & entry,
+        const VSFrameRef * output,
+        const VSAPI * vsapi
+    ) noexcept {
+
+        std::lock_guard lock { mutex };
+
+        if (output) {
+            entry->output = vsapi->cloneFrameRef(output);
+        } else {
+            entry->failed = true;
+            entries.erase(std::find(std::begin(entries), std::end(entries), entry));
+        }
+
+        cv.notify_all();
+    }
+
+    void clear() noexcept {
+        std::lock_guard lock { mutex };
+        entries.clear();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<Entry>> entries;
+
+    static uint64_t hashFrames(
+        const std::vector<const VSFrameRef *> & frames,
+        const VSAPI * vsapi
+    ) noexcept {
+
+        const auto & kernels = getCopyKernels();
+
+        uint64_t hash = 0;
+        for (const auto & frame : frames) {
+            const VSFormat * format = vsapi->getFrameFormat(frame);
+            for (int plane = 0; plane < format->numPlanes; ++plane) {
+                hash = kernels.hash(
+                    vsapi->getReadPtr(frame, plane),
+                    vsapi->getStride(frame, plane),
+                    static_cast<size_t>(vsapi->getFrameWidth(frame, plane)) * format->bytesPerSample,
+                    vsapi->getFrameHeight(frame, plane),
+                    hash
+                );
+            }
+        }
+
+        return hash;
+    }
+
+    static bool isEqual(
+        const std::vector<const VSFrameRef *> & lhs,
+        const std::vector<const VSFrameRef *> & rhs,
+        const VSAPI * vsapi
+    ) noexcept {
+
+        for (unsigned i = 0; i < std::size(lhs); ++i) {
+            const VSFormat * format = vsapi->getFrameFormat(lhs[i]);
+            for (int plane = 0; plane < format->numPlanes; ++plane) {
+                if (!planesEqual(
+                    vsapi->getReadPtr(lhs[i], plane), vsapi->getStride(lhs[i], plane),
+                    vsapi->getReadPtr(rhs[i], plane), vsapi->getStride(rhs[i], plane),
+                    static_cast<size_t>(vsapi->getFrameWidth(lhs[i], plane)) * format->bytesPerSample,
+                    vsapi->getFrameHeight(lhs[i], plane)
+                )) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool isSimilar(
+        const std::vector<const VSFrameRef *> & lhs,
+        const std::vector<const VSFrameRef *> & rhs,
+        const VSAPI * vsapi
+    ) const noexcept {
+
+        for (unsigned i = 0; i < std::size(lhs); ++i) {
+            const VSFormat * format = vsapi->getFrameFormat(lhs[i]);
+            for (int plane = 0; plane < format->numPlanes; ++plane) {
+                if (!planesSimilar(
+                    vsapi->getReadPtr(lhs[i], plane), vsapi->getStride(lhs[i], plane),
+                    vsapi->getReadPtr(rhs[i], plane), vsapi->getStride(rhs[i], plane),
+                    vsapi->getFrameWidth(lhs[i], plane), vsapi->getFrameHeight(lhs[i], plane),
+                    getSampleFormat(format), threshold
+                )) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+};
+
+#endif // VSMLRT_COMMON_FRAME_DEDUPLICATOR_H_
@@ -0,0 +1,303 @@
+#ifndef VSMLRT_COMMON_ONNX_CACHE_H_
+#define VSMLRT_COMMON_ONNX_CACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include <onnx/common/version.h>
+#include <onnx/onnx_pb.h>
+
+#include "sha256.h"
+
+// Persistent cache of preprocessed networks.
+//
+// Specifying the input shape of a network re-runs the shape inference of
+// ONNX and the fp16 conversion walks the whole graph, which dominates the
+// startup of scripts that chain a few networks. The serialized result is
+// stored in a directory under a SHA-256 digest of the source network and of
+// the preprocessing options, and memory-mapped on later runs, as is the
+// overlap derived from the receptive field. Entries are written under a
+// temporary name and renamed once complete, so concurrent processes never
+// read a partial entry.
+
+// a read-only mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() noexcept = default;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile && other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile & operator=(MappedFile && other) noexcept {
+        if (this != &other) {
+            close();
+            std::swap(address, other.address);
+            std::swap(size, other.size);
+        }
+        return *this;
+    }
+
+    ~MappedFile() noexcept {
+        close();
+    }
+
+    // returns false if the file can not be opened, an empty file is mapped
+    // to an empty view
+    bool open(const std::filesystem::path & path) noexcept {
+        close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileW(
+            path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+        );
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size)) {
+            CloseHandle(file);
+            return false;
+        }
+
+        if (file_size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+
+        if (file_size.QuadPart > 0 && !address) {
+            return false;
+        }
+        size = static_cast<size_t>(file_size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+
+        if (st.st_size > 0) {
+            void * ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            address = ptr;
+        }
+        ::close(fd);
+
+        size = static_cast<size_t>(st.st_size);
+#endif // _WIN32
+
+        return true;
+    }
+
+    std::string_view data() const noexcept {
+        return { static_cast<const char *>(address), size };
+    }
+
+private:
+    void * address {};
+    size_t size {};
+
+    void close() noexcept {
+        if (address) {
+#ifdef _WIN32
+            UnmapViewOfFile(address);
+#else
+            munmap(address, size);
+#endif // _WIN32
+        }
+        address = nullptr;
+        size = 0;
+    }
+};
+
+// a serialized network, either preprocessed in this process or mapped from
+// the cache
+struct SerializedModel {
+    std::string owned;
+    MappedFile mapped;
+
+    std::string_view data() const noexcept {
+        return std::empty(owned) ? mapped.data() : std::string_view { owned };
+    }
+};
+
+// The helpers that return digests and paths only throw std::bad_alloc, the
+// ones that access the cache treat any failure as a miss.
+
+// the digest of a source network, shared by all of its entries
+static inline
+std::string sourceDigest(std::string_view source) {
+    return Sha256 {}.update(source).hexdigest();
+}
+
+// The path of an entry of a source network in a cache directory. The
+// entries depend on the versions of ONNX and of the plugin, which is given
+// by `tag`.
+static inline
+std::filesystem::path cacheEntryPath(
+    const std::filesystem::path & directory,
+    const std::string & source_digest,
+    const std::string & name,
+    std::string_view tag
+) {
+
+    const auto digest = (
+        Sha256 {}
+            .update(source_digest)
+            .update(name).update("\n")
+            .update(tag).update("\n")
+            .update(ONNX_NAMESPACE::LAST_RELEASE_VERSION)
+            .hexdigest()
+    );
+
+    return directory / (digest + "_" + name);
+}
+
+static inline
+std::filesystem::path preprocessedModelPath(
+    const std::filesystem::path & directory,
+    const std::string & source_digest,
+    int64_t tile_w,
+    int64_t tile_h,
+    int64_t batch,
+    bool fp16,
+    bool fp16_io,
+    std::string_view tag
+) {
+
+    return cacheEntryPath(
+        directory, source_digest,
+        std::to_string(tile_w) + "x" + std::to_string(tile_h) + "x" + std::to_string(batch) +
+        (fp16 ? (fp16_io ? "_fp16io" : "_fp16") : "") + ".preprocessed.onnx",
+        tag
+    );
+}
+
+static inline
+std::filesystem::path overlapPath(
+    const std::filesystem::path & directory,
+    const std::string & source_digest,
+    int64_t tile_w,
+    int64_t tile_h,
+    std::string_view tag
+) {
+
+    return cacheEntryPath(
+        directory, source_digest,
+        std::to_string(tile_w) + "x" + std::to_string(tile_h) + ".overlap",
+        tag
+    );
+}
+
+// a unique name next to `path` for an entry that is being written, empty if
+// none can be generated
+static inline
+std::filesystem::path temporaryPath(const std::filesystem::path & path) noexcept {
+    try {
+        auto tmp_path = path;
+        tmp_path += ".tmp" + std::to_string(std::random_device {}());
+        return tmp_path;
+    } catch (...) {
+        return {};
+    }
+}
+
+// Stores `data` in the cache, failures are ignored since the entry is
+// created again on the next run.
+static inline
+void storeEntry(const std::filesystem::path & path, std::string_view data) noexcept {
+    const auto tmp_path = temporaryPath(path);
+    if (std::empty(tmp_path)) {
+        return;
+    }
+
+    std::error_code ec;
+    try {
+        std::ofstream file { tmp_path, std::ios::binary };
+        file.write(std::data(data), static_cast<std::streamsize>(std::size(data)));
+        file.close();
+
+        if (!file) {
+            std::filesystem::remove(tmp_path, ec);
+            return;
+        }
+    } catch (...) {
+        std::filesystem::remove(tmp_path, ec);
+        return;
+    }
+
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_path, ec);
+    }
+}
+
+static inline
+std::optional<std::array<int, 2>> loadOverlap(const std::filesystem::path & path) noexcept {
+    try {
+        std::ifstream file { path };
+
+        std::array<int, 2> overlap;
+        if (!(file >> overlap[0] >> overlap[1])) {
+            return {};
+        }
+
+        return overlap;
+    } catch (...) {
+        return {};
+    }
+}
+
+static inline
+void storeOverlap(const std::filesystem::path & path, const std::array<int, 2> & overlap) noexcept {
+    std::string data;
+    try {
+        data = std::to_string(overlap[0]) + " " + std::to_string(overlap[1]);
+    } catch (...) {
+        return;
+    }
+
+    storeEntry(path, data);
+}
+
+#endif // VSMLRT_COMMON_ONNX_CACHE_H_
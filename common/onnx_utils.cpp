@@ -1,6 +1,13 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <map>
 #include <optional>
+#include <set>
 #include <variant>
 #include <string>
 #include <string_view>
@@ -10,9 +17,15 @@
 
 
 std::variant<std::string, ONNX_NAMESPACE::ModelProto> loadONNX(
-    const std::string & path,
+    const std::string_view & path,
     int64_t tile_w,
-    int64_t tile_h
+    int64_t tile_h,
+    int64_t batch,
+    bool path_is_serialization
+) noexcept;
+
+std::variant<std::string, std::array<int, 2>> receptiveFieldOverlap(
+    const ONNX_NAMESPACE::ModelProto & model
 ) noexcept;
 
 
@@ -101,6 +114,7 @@ std::variant<std::string, ONNX_NAMESPACE::ModelProto> loadONNX(
     const std::string_view & path,
     int64_t tile_w,
     int64_t tile_h,
+    int64_t batch,
     bool path_is_serialization
 ) noexcept {
 
@@ -125,9 +139,439 @@ std::variant<std::string, ONNX_NAMESPACE::ModelProto> loadONNX(
         }
     }
 
-    if (auto err = specifyShape(onnx_proto, tile_w, tile_h); err.has_value()) {
+    if (auto err = specifyShape(onnx_proto, tile_w, tile_h, batch); err.has_value()) {
         return err.value();
     }
 
     return onnx_proto;
 }
+
+
+// spatial extent of a tensor relative to the network input, the radius is
+// measured in input pixels and the scale is the size ratio to the input
+//
+// The spatial axes are the last two axes of every tensor.
+struct Field {
+    std::array<double, 2> radius; // (w, h)
+    std::array<double, 2> scale;
+};
+
+static std::optional<std::array<int64_t, 2>> spatialDims(
+    const ONNX_NAMESPACE::ValueInfoProto & info
+) noexcept {
+
+    const auto & shape = info.type().tensor_type().shape();
+    if (shape.dim_size() != 4 || !shape.dim(2).has_dim_value() || !shape.dim(3).has_dim_value()) {
+        return {};
+    }
+
+    return std::array<int64_t, 2> { shape.dim(3).dim_value(), shape.dim(2).dim_value() };
+}
+
+static std::vector<int64_t> intsAttribute(
+    const ONNX_NAMESPACE::NodeProto & node,
+    const std::string & name
+) noexcept {
+
+    for (const auto & attribute : node.attribute()) {
+        if (attribute.name() == name) {
+            return { std::cbegin(attribute.ints()), std::cend(attribute.ints()) };
+        }
+    }
+
+    return {};
+}
+
+static bool hasAttribute(
+    const ONNX_NAMESPACE::NodeProto & node,
+    const std::string & name
+) noexcept {
+
+    for (const auto & attribute : node.attribute()) {
+        if (attribute.name() == name) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static std::optional<int64_t> intAttribute(
+    const ONNX_NAMESPACE::NodeProto & node,
+    const std::string & name
+) noexcept {
+
+    for (const auto & attribute : node.attribute()) {
+        if (attribute.name() == name) {
+            return attribute.i();
+        }
+    }
+
+    return {};
+}
+
+static std::string stringAttribute(
+    const ONNX_NAMESPACE::NodeProto & node,
+    const std::string & name
+) noexcept {
+
+    for (const auto & attribute : node.attribute()) {
+        if (attribute.name() == name) {
+            return attribute.s();
+        }
+    }
+
+    return {};
+}
+
+static std::optional<std::vector<int64_t>> tensorInts(
+    const ONNX_NAMESPACE::TensorProto & tensor
+) noexcept {
+
+    if (tensor.data_type() == ONNX_NAMESPACE::TensorProto::INT64) {
+        if (tensor.has_raw_data()) {
+            const auto & raw = tensor.raw_data();
+            std::vector<int64_t> values(std::size(raw) / sizeof(int64_t));
+            std::memcpy(std::data(values), std::data(raw), std::size(values) * sizeof(int64_t));
+            return values;
+        }
+        return std::vector<int64_t> { std::cbegin(tensor.int64_data()), std::cend(tensor.int64_data()) };
+    } else if (tensor.data_type() == ONNX_NAMESPACE::TensorProto::INT32) {
+        if (tensor.has_raw_data()) {
+            const auto & raw = tensor.raw_data();
+            std::vector<int32_t> values(std::size(raw) / sizeof(int32_t));
+            std::memcpy(std::data(values), std::data(raw), std::size(values) * sizeof(int32_t));
+            return std::vector<int64_t> { std::cbegin(values), std::cend(values) };
+        }
+        return std::vector<int64_t> { std::cbegin(tensor.int32_data()), std::cend(tensor.int32_data()) };
+    }
+
+    return {};
+}
+
+// an integer list that is an attribute in early opsets and a constant input
+// in later ones, empty if neither is given and unknown if the input is not
+// a constant
+static std::optional<std::vector<int64_t>> intsOperand(
+    const ONNX_NAMESPACE::NodeProto & node,
+    const std::string & name,
+    int index,
+    const std::map<std::string, const ONNX_NAMESPACE::TensorProto *> & constants
+) noexcept {
+
+    if (hasAttribute(node, name)) {
+        return intsAttribute(node, name);
+    }
+
+    if (index < node.input_size() && !std::empty(node.input(index))) {
+        if (auto it = constants.find(node.input(index)); it != std::cend(constants)) {
+            return tensorInts(*it->second);
+        }
+        return {};
+    }
+
+    return std::vector<int64_t> {};
+}
+
+// the smallest overlap that makes the interior of tiled output equal to
+// the output of the whole frame, derived from the receptive field of the
+// network by walking its (topologically sorted) nodes
+//
+// The overlap is measured in output samples, as the tiles are cropped, and
+// is the radius scaled by the output size ratio of the network. The model
+// must have inferred shapes. Any operator that mixes distant pixels is
+// rejected, including global pooling of squeeze and excitation blocks, whose
+// output depends on the whole tile, and reshaping or transposing, which may
+// move samples between positions.
+std::variant<std::string, std::array<int, 2>> receptiveFieldOverlap(
+    const ONNX_NAMESPACE::ModelProto & model
+) noexcept {
+
+    const auto & graph = model.graph();
+
+    std::map<std::string, std::array<int64_t, 2>> dims;
+    std::map<std::string, int> ranks;
+    for (const auto & infos : { &graph.input(), &graph.value_info(), &graph.output() }) {
+        for (const auto & info : *infos) {
+            if (auto result = spatialDims(info); result.has_value()) {
+                dims[info.name()] = result.value();
+            }
+            if (info.type().tensor_type().has_shape()) {
+                ranks[info.name()] = info.type().tensor_type().shape().dim_size();
+            }
+        }
+    }
+
+    std::map<std::string, std::vector<int64_t>> initializer_dims;
+    std::map<std::string, const ONNX_NAMESPACE::TensorProto *> constants;
+    for (const auto & initializer : graph.initializer()) {
+        initializer_dims[initializer.name()] = { std::cbegin(initializer.dims()), std::cend(initializer.dims()) };
+        constants[initializer.name()] = &initializer;
+    }
+    for (const auto & node : graph.node()) {
+        if (node.op_type() == "Constant" && node.output_size() == 1) {
+            for (const auto & attribute : node.attribute()) {
+                if (attribute.name() == "value") {
+                    constants[node.output(0)] = &attribute.t();
+                }
+            }
+        }
+    }
+
+    const auto & input_name = graph.input(0).name();
+    if (dims.count(input_name) == 0) {
+        return "unknown input dimensions"s;
+    }
+    const auto input_dims = dims[input_name];
+
+    std::map<std::string, Field> fields;
+    fields[input_name] = Field { { 0.0, 0.0 }, { 1.0, 1.0 } };
+
+    // operators that only combine samples at the same position
+    static const std::set<std::string> pointwise {
+        "Abs", "Add", "And", "BatchNormalization", "Cast", "Ceil", "Clip", "Div",
+        "Dropout", "Elu", "Equal", "Erf", "Exp", "Floor", "Gelu", "Greater",
+        "HardSigmoid", "HardSwish", "Identity", "LeakyRelu", "Less", "Log", "Max",
+        "Mean", "Min", "Mish", "Mul", "Neg", "Not", "Or", "Pow", "PRelu",
+        "Reciprocal", "Relu", "Round", "Selu", "Sigmoid", "Sign", "Softplus",
+        "Softsign", "Sqrt", "Sub", "Sum", "Tanh", "Where"
+    };
+
+    // operators that select or combine channels, which preserve the
+    // positions of samples as long as their axes are not spatial
+    static const std::set<std::string> channelwise {
+        "Concat", "Slice", "Split", "Squeeze", "Unsqueeze"
+    };
+
+    // operators whose output does not depend on the values of the input
+    static const std::set<std::string> global {
+        "Shape", "Size"
+    };
+
+    // operators whose output depends on every sample of the input
+    static const std::set<std::string> pooling {
+        "GlobalAveragePool", "GlobalLpPool", "GlobalMaxPool"
+    };
+
+    double min_scale = 1.0;
+
+    for (const auto & node : graph.node()) {
+        std::optional<Field> base;
+        for (const auto & name : node.input()) {
+            if (auto it = fields.find(name); it != std::cend(fields)) {
+                if (!base.has_value()) {
+                    base = it->second;
+                } else {
+                    for (int i = 0; i < 2; ++i) {
+                        base->radius[i] = std::max(base->radius[i], it->second.radius[i]);
+                    }
+                }
+            }
+        }
+
+        // constants and shapes
+        if (!base.has_value() || global.count(node.op_type())) {
+            continue;
+        }
+
+        if (pooling.count(node.op_type())) {
+            return "the output of "s + node.op_type() + " depends on the whole tile, no overlap is exact";
+        }
+
+        // the scale of the data input
+        if (auto it = fields.find(node.input(0)); it != std::cend(fields)) {
+            base->scale = it->second.scale;
+        }
+
+        Field field = base.value();
+        const auto & op = node.op_type();
+
+        // number of samples of the node input that each side of a sample
+        // of the node output depends on
+        std::array<double, 2> extent { 0.0, 0.0 };
+
+        if (op == "Conv" || op == "ConvTranspose" || op == "MaxPool" ||
+            op == "AveragePool" || op == "LpPool"
+        ) {
+            auto kernel = intsAttribute(node, "kernel_shape");
+            if (std::empty(kernel) && std::size(node.input()) > 1) {
+                if (auto it = initializer_dims.find(node.input(1)); it != std::cend(initializer_dims) &&
+                    std::size(it->second) == 4
+                ) {
+                    kernel = { it->second[2], it->second[3] };
+                }
+            }
+            if (std::size(kernel) != 2) {
+                return "unknown kernel shape of "s + op;
+            }
+
+            auto strides = intsAttribute(node, "strides");
+            if (std::empty(strides)) {
+                strides = { 1, 1 };
+            }
+            auto dilations = intsAttribute(node, "dilations");
+            if (std::empty(dilations)) {
+                dilations = { 1, 1 };
+            }
+            auto pads = intsAttribute(node, "pads");
+            if (std::empty(pads)) {
+                pads = { 0, 0, 0, 0 };
+            }
+            const auto auto_pad = stringAttribute(node, "auto_pad");
+
+            // attributes are (h, w)
+            for (int i = 0; i < 2; ++i) {
+                const int axis = 1 - i;
+                const int64_t span = (kernel[axis] - 1) * dilations[axis];
+
+                int64_t begin = pads[axis];
+                if (auto_pad == "SAME_UPPER" || auto_pad == "SAME_LOWER") {
+                    begin = (auto_pad == "SAME_UPPER") ? span / 2 : (span + 1) / 2;
+                } else if (auto_pad == "VALID") {
+                    begin = 0;
+                }
+
+                if (op == "ConvTranspose") {
+                    extent[i] = std::ceil(static_cast<double>(span) / strides[axis]);
+                    field.scale[i] *= strides[axis];
+                } else {
+                    extent[i] = static_cast<double>(std::max(begin, span - begin));
+                    field.scale[i] /= strides[axis];
+                }
+            }
+        } else if (op == "Resize" || op == "Upsample") {
+            auto mode = stringAttribute(node, "mode");
+            if (mode == "linear" || mode == "bilinear") {
+                extent = { 1.0, 1.0 };
+            } else if (mode == "cubic" || mode == "bicubic") {
+                extent = { 2.0, 2.0 };
+            }
+        } else if (op == "DepthToSpace") {
+            const auto blocksize = static_cast<double>(intAttribute(node, "blocksize").value_or(1));
+            field.scale = { field.scale[0] * blocksize, field.scale[1] * blocksize };
+        } else if (op == "SpaceToDepth") {
+            const auto blocksize = static_cast<double>(intAttribute(node, "blocksize").value_or(1));
+            extent = { blocksize - 1, blocksize - 1 };
+            field.scale = { field.scale[0] / blocksize, field.scale[1] / blocksize };
+        } else if (op == "Pad") {
+            const auto pads = intsOperand(node, "pads", 1, constants);
+            auto axes = intsOperand(node, "axes", 3, constants);
+            if (!pads.has_value() || !axes.has_value() || std::size(pads.value()) % 2 != 0) {
+                return "unknown pads of Pad"s;
+            }
+
+            const auto count = static_cast<int64_t>(std::size(pads.value()) / 2);
+            if (std::empty(axes.value())) {
+                for (int64_t i = 0; i < count; ++i) {
+                    axes->push_back(i);
+                }
+            } else if (static_cast<int64_t>(std::size(axes.value())) != count) {
+                return "unknown pads of Pad"s;
+            }
+
+            int64_t rank = count;
+            if (auto it = ranks.find(node.input(0)); it != std::cend(ranks)) {
+                rank = it->second;
+            }
+
+            // the padding shifts the samples and replaces the ones at the
+            // borders of the tile
+            for (int64_t i = 0; i < count; ++i) {
+                const auto axis = (axes.value()[i] < 0) ? axes.value()[i] + rank : axes.value()[i];
+                if (axis >= rank - 2 && axis < rank) {
+                    auto & side = extent[rank - 1 - axis];
+                    side = std::max({
+                        side,
+                        static_cast<double>(std::abs(pads.value()[i])),
+                        static_cast<double>(std::abs(pads.value()[i + count]))
+                    });
+                }
+            }
+        } else if (channelwise.count(op)) {
+            std::optional<std::vector<int64_t>> axes;
+            std::string rank_name = node.input(0);
+            if (op == "Concat" || op == "Split") {
+                axes = std::vector<int64_t> { intAttribute(node, "axis").value_or(0) };
+            } else if (op == "Slice") {
+                axes = intsOperand(node, "axes", 3, constants);
+                if (axes.has_value() && std::empty(axes.value())) {
+                    // all leading axes
+                    if (auto starts = intsOperand(node, "starts", 1, constants); starts.has_value()) {
+                        for (int64_t i = 0; i < static_cast<int64_t>(std::size(starts.value())); ++i) {
+                            axes->push_back(i);
+                        }
+                    } else {
+                        axes.reset();
+                    }
+                }
+            } else {
+                axes = intsOperand(node, "axes", 1, constants);
+                if (op == "Unsqueeze") {
+                    rank_name = node.output(0);
+                }
+            }
+
+            auto it = ranks.find(rank_name);
+            if (!axes.has_value() || std::empty(axes.value()) || it == std::cend(ranks)) {
+                return "unknown axes of "s + op;
+            }
+            const int64_t rank = it->second;
+
+            for (auto axis : axes.value()) {
+                if (axis < 0) {
+                    axis += rank;
+                }
+
+                // Concat, Slice and Split may only select channels, the axis
+                // in front of the spatial ones
+                const bool preserved = (
+                    (op == "Squeeze" || op == "Unsqueeze") ? (axis < rank - 2) : (axis == rank - 3)
+                );
+                if (!preserved) {
+                    return op + " along axis "s + std::to_string(axis) + " moves samples between positions";
+                }
+            }
+        } else if (pointwise.count(op) == 0) {
+            return "cannot derive the receptive field of "s + op;
+        }
+
+        for (int i = 0; i < 2; ++i) {
+            field.radius[i] += extent[i] / base->scale[i];
+        }
+
+        for (const auto & name : node.output()) {
+            Field output = field;
+
+            // inferred shapes take precedence, e.g. for resizing
+            if (auto it = dims.find(name); it != std::cend(dims)) {
+                for (int i = 0; i < 2; ++i) {
+                    output.scale[i] = static_cast<double>(it->second[i]) / input_dims[i];
+                }
+            }
+
+            min_scale = std::min({ min_scale, output.scale[0], output.scale[1] });
+            fields[name] = output;
+        }
+    }
+
+    const auto & output_name = graph.output(0).name();
+    if (fields.count(output_name) == 0) {
+        return "the output does not depend on the input"s;
+    }
+    const auto & output = fields[output_name];
+
+    // Downsampling networks only match the whole frame if the tile step is
+    // a multiple of their total stride, which holds for tile sizes that
+    // are multiples of it if the overlap is a multiple of half of it.
+    const int stride = static_cast<int>(std::lround(1.0 / min_scale));
+    const int alignment = std::max(1, stride / 2);
+
+    // the output samples of a tile that depend on samples beyond its borders
+    std::array<int, 2> overlap;
+    for (int i = 0; i < 2; ++i) {
+        overlap[i] = static_cast<int>(std::ceil(output.radius[i] * output.scale[i] - 1e-6));
+        overlap[i] = (overlap[i] + alignment - 1) / alignment * alignment;
+    }
+
+    return overlap;
+}
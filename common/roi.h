@@ -0,0 +1,158 @@
+#ifndef VSMLRT_COMMON_ROI_H_
+#define VSMLRT_COMMON_ROI_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+#include "copy_kernels.h"
+#include "tiling.h"
+
+// Restricts inference to the tiles whose output intersects a region of the
+// source frame, given either as a rectangle or as the non-zero samples of a
+// mask plane. The output of the other tiles is a bilinear resize of the
+// source, which passes the source through if the network does not scale.
+
+struct RegionOfInterest {
+    // source rectangle, used without a mask
+    int left;
+    int top;
+    int width;
+    int height;
+
+    SampleFormat mask_format;
+
+    // Fills the output of the tiles of `jobs` outside of the region and
+    // removes them from `jobs`. `mask` is a plane of the source size if not
+    // null. Returns the number of removed tiles.
+    int select(
+        const TilePlan & plan,
+        std::vector<TileJob> & jobs,
+        const uint8_t * mask,
+        int mask_stride
+    ) const noexcept {
+
+        int skipped = 0;
+        auto kept = std::begin(jobs);
+        for (const auto & job : jobs) {
+            const auto [x0, y0, x1, y1] = sourceRect(plan, *job.tile);
+
+            bool selected;
+            if (mask) {
+                selected = isMasked(mask, mask_stride, mask_format, x0, y0, x1, y1);
+            } else {
+                selected = (
+                    x0 < left + width && left < x1 &&
+                    y0 < top + height && top < y1
+                );
+            }
+
+            if (selected) {
+                *kept++ = job;
+            } else {
+                resizeTile(plan, *job.tile, *job.io);
+                ++skipped;
+            }
+        }
+        jobs.erase(kept, std::end(jobs));
+
+        return skipped;
+    }
+
+private:
+    struct Rect {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    // the source samples of the output of a tile
+    static Rect sourceRect(const TilePlan & plan, const Tile & tile) noexcept {
+        return Rect {
+            tile.dst_x / plan.w_scale,
+            tile.dst_y / plan.h_scale,
+            (tile.dst_x + tile.dst_w + plan.w_scale - 1) / plan.w_scale,
+            (tile.dst_y + tile.dst_h + plan.h_scale - 1) / plan.h_scale
+        };
+    }
+
+    static bool isMasked(
+        const uint8_t * mask, int stride, const SampleFormat & format,
+        int x0, int y0, int x1, int y1
+    ) noexcept {
+
+        for (int y = y0; y < y1; ++y) {
+            const uint8_t * maskp = mask + static_cast<size_t>(y) * stride;
+            for (int x = x0; x < x1; ++x) {
+                if (normalizedSample(maskp, x, format, 1.f) != 0.f) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    static void resizeTile(const TilePlan & plan, const Tile & tile, const FrameIO & io) noexcept {
+        const float src_scale = (
+            plan.src_format.is_float ? 1.f : 1.f / static_cast<float>((1 << plan.src_format.bits) - 1)
+        );
+        const float dst_peak = (
+            plan.dst_format.is_float ? 1.f : static_cast<float>((1 << plan.dst_format.bits) - 1)
+        );
+
+        // sample centers are aligned
+        const auto taps = [](int dst, int scale, int size) {
+            float pos = std::clamp((dst + 0.5f) / scale - 0.5f, 0.f, static_cast<float>(size - 1));
+            int first = static_cast<int>(pos);
+            return std::make_tuple(first, std::min(first + 1, size - 1), pos - first);
+        };
+
+        std::vector<int> xs0(tile.dst_w), xs1(tile.dst_w);
+        std::vector<float> wxs(tile.dst_w);
+        for (int x = 0; x < tile.dst_w; ++x) {
+            std::tie(xs0[x], xs1[x], wxs[x]) = taps(tile.dst_x + x, plan.w_scale, plan.src_width);
+        }
+
+        std::vector<float> row(tile.dst_w);
+
+        for (int plane = 0; plane < plan.dst_planes; ++plane) {
+            for (int y = 0; y < tile.dst_h; ++y) {
+                const auto [y0, y1, wy] = taps(tile.dst_y + y, plan.h_scale, plan.src_height);
+                const uint8_t * src0 = io.src_ptrs[plane] + static_cast<size_t>(y0) * io.src_stride;
+                const uint8_t * src1 = io.src_ptrs[plane] + static_cast<size_t>(y1) * io.src_stride;
+
+                for (int x = 0; x < tile.dst_w; ++x) {
+                    const auto sample = [&](const uint8_t * srcp) {
+                        float a = normalizedSample(srcp, xs0[x], plan.src_format, src_scale);
+                        float b = normalizedSample(srcp, xs1[x], plan.src_format, src_scale);
+                        return a + (b - a) * wxs[x];
+                    };
+                    float upper = sample(src0);
+                    row[x] = upper + (sample(src1) - upper) * wy;
+                }
+
+                uint8_t * dstp = io.dst_ptrs[plane] + (
+                    static_cast<size_t>(tile.dst_y + y) * io.dst_stride +
+                    static_cast<size_t>(tile.dst_x) * plan.dst_format.bytes
+                );
+
+                if (plan.dst_format.is_float && plan.dst_format.bytes == 4) {
+                    std::memcpy(dstp, std::data(row), std::size(row) * sizeof(float));
+                } else if (plan.dst_format.is_float) {
+                    toHalfRow(reinterpret_cast<uint16_t *>(dstp), std::data(row), tile.dst_w, 1.f);
+                } else if (plan.dst_format.bytes == 1) {
+                    quantizeRow(dstp, std::data(row), tile.dst_w, dst_peak, dst_peak);
+                } else {
+                    quantizeRow(reinterpret_cast<uint16_t *>(dstp), std::data(row), tile.dst_w, dst_peak, dst_peak);
+                }
+            }
+        }
+    }
+};
+
+#endif // VSMLRT_COMMON_ROI_H_
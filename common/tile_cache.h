@@ -0,0 +1,225 @@
+#ifndef VSMLRT_COMMON_TILE_CACHE_H_
+#define VSMLRT_COMMON_TILE_CACHE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "copy_kernels.h"
+#include "frame_deduplicator.h"
+#include "tiling.h"
+
+// Reuses the output of tiles whose source did not change.
+//
+// Every tile position keeps a copy of its source window and of its cropped
+// output from the last frame in which it was inferred, so no frames are
+// held. The source window includes the overlap, so equal sources produce
+// equal output, and tiles are compared as in FrameDeduplicator. Reused tiles
+// keep their copies, so that a slowly changing tile is compared against the
+// source its output was inferred from and does not drift within the
+// threshold. Blending is not supported, since the output of a tile is not
+// separable from that of its neighbours.
+
+struct TileCache {
+    // 0: exact comparison
+    float threshold;
+
+    // Copies the output of the tiles of `jobs` whose source equals the
+    // remembered source of their position and removes them from `jobs`.
+    // `hashes` receives the source hashes of all tiles of the plan.
+    // Returns the number of reused tiles.
+    int reuse(
+        const TilePlan & plan,
+        std::vector<TileJob> & jobs,
+        std::vector<uint64_t> & hashes
+    ) noexcept {
+
+        hashes.assign(std::size(plan.tiles), 0);
+
+        int reused = 0;
+        auto kept = std::begin(jobs);
+        for (const auto & job : jobs) {
+            const auto index = job.tile - std::data(plan.tiles);
+
+            if (threshold == 0.f) {
+                hashes[index] = hashTile(plan, *job.tile, *job.io);
+            }
+
+            Slot & slot = getSlot(plan, index);
+            std::lock_guard lock { slot.mutex };
+
+            if (slot.valid && matches(plan, *job.tile, *job.io, hashes[index], slot)) {
+                copyOutput(plan, *job.tile, slot, *job.io);
+                ++reused;
+            } else {
+                *kept++ = job;
+            }
+        }
+        jobs.erase(kept, std::end(jobs));
+
+        return reused;
+    }
+
+    // copies the source and output of the inferred `jobs`
+    void update(
+        const TilePlan & plan,
+        const std::vector<TileJob> & jobs,
+        const std::vector<uint64_t> & hashes
+    ) noexcept {
+
+        for (const auto & job : jobs) {
+            const auto index = job.tile - std::data(plan.tiles);
+            const Tile & tile = *job.tile;
+            const FrameIO & io = *job.io;
+
+            Slot & slot = getSlot(plan, index);
+            std::lock_guard lock { slot.mutex };
+
+            const size_t src_row_bytes = static_cast<size_t>(tile.src_w) * plan.src_format.bytes;
+            const size_t src_plane_bytes = src_row_bytes * tile.src_h;
+            slot.src.resize(plan.src_planes * src_plane_bytes);
+            for (int plane = 0; plane < plan.src_planes; ++plane) {
+                copyPlane(
+                    &slot.src[plane * src_plane_bytes], src_row_bytes,
+                    io.src_ptrs[plane] + srcOffset(plan, tile, io.src_stride), io.src_stride,
+                    src_row_bytes, tile.src_h
+                );
+            }
+
+            const size_t dst_row_bytes = static_cast<size_t>(tile.dst_w) * plan.dst_format.bytes;
+            const size_t dst_plane_bytes = dst_row_bytes * tile.dst_h;
+            slot.dst.resize(plan.dst_planes * dst_plane_bytes);
+            for (int plane = 0; plane < plan.dst_planes; ++plane) {
+                copyPlane(
+                    &slot.dst[plane * dst_plane_bytes], dst_row_bytes,
+                    io.dst_ptrs[plane] + dstOffset(plan, tile, io.dst_stride), io.dst_stride,
+                    dst_row_bytes, tile.dst_h
+                );
+            }
+
+            slot.hash = hashes[index];
+            slot.valid = true;
+        }
+    }
+
+private:
+    // the copies of a tile position, sized on first use
+    struct Slot {
+        std::mutex mutex;
+        bool valid {};
+        uint64_t hash {};
+        std::vector<uint8_t> src; // planes of the source window, with the overlap
+        std::vector<uint8_t> dst; // planes of the cropped output
+    };
+
+    std::mutex mutex;
+    std::unique_ptr<Slot[]> slots; // per tile of the plan
+
+    Slot & getSlot(const TilePlan & plan, ptrdiff_t index) noexcept {
+        std::lock_guard lock { mutex };
+        if (!slots) {
+            slots = std::make_unique<Slot[]>(std::size(plan.tiles));
+        }
+        return slots[index];
+    }
+
+    static size_t srcOffset(const TilePlan & plan, const Tile & tile, int stride) noexcept {
+        return (
+            static_cast<size_t>(tile.src_y) * stride +
+            static_cast<size_t>(tile.src_x) * plan.src_format.bytes
+        );
+    }
+
+    static size_t dstOffset(const TilePlan & plan, const Tile & tile, int stride) noexcept {
+        return (
+            static_cast<size_t>(tile.dst_y) * stride +
+            static_cast<size_t>(tile.dst_x) * plan.dst_format.bytes
+        );
+    }
+
+    static void copyPlane(
+        uint8_t * dstp, size_t dst_stride,
+        const uint8_t * srcp, size_t src_stride,
+        size_t row_bytes, int height
+    ) noexcept {
+
+        for (int y = 0; y < height; ++y) {
+            std::memcpy(dstp + y * dst_stride, srcp + y * src_stride, row_bytes);
+        }
+    }
+
+    static uint64_t hashTile(const TilePlan & plan, const Tile & tile, const FrameIO & io) noexcept {
+        const auto & kernels = getCopyKernels();
+        const size_t offset = srcOffset(plan, tile, io.src_stride);
+
+        uint64_t hash = 0;
+        for (int plane = 0; plane < plan.src_planes; ++plane) {
+            hash = kernels.hash(
+                io.src_ptrs[plane] + offset, io.src_stride,
+                static_cast<size_t>(tile.src_w) * plan.src_format.bytes, tile.src_h,
+                hash
+            );
+        }
+
+        return hash;
+    }
+
+    bool matches(
+        const TilePlan & plan,
+        const Tile & tile,
+        const FrameIO & io,
+        uint64_t hash,
+        const Slot & slot
+    ) const noexcept {
+
+        if (threshold == 0.f && hash != slot.hash) {
+            return false;
+        }
+
+        const size_t offset = srcOffset(plan, tile, io.src_stride);
+        const size_t row_bytes = static_cast<size_t>(tile.src_w) * plan.src_format.bytes;
+        const size_t plane_bytes = row_bytes * tile.src_h;
+
+        for (int plane = 0; plane < plan.src_planes; ++plane) {
+            const uint8_t * srcp = io.src_ptrs[plane] + offset;
+            const uint8_t * cachedp = &slot.src[plane * plane_bytes];
+
+            bool equal = (threshold == 0.f) ? planesEqual(
+                srcp, io.src_stride, cachedp, static_cast<ptrdiff_t>(row_bytes),
+                row_bytes, tile.src_h
+            ) : planesSimilar(
+                srcp, io.src_stride, cachedp, static_cast<ptrdiff_t>(row_bytes),
+                tile.src_w, tile.src_h, plan.src_format, threshold
+            );
+
+            if (!equal) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static void copyOutput(
+        const TilePlan & plan,
+        const Tile & tile,
+        const Slot & slot,
+        const FrameIO & io
+    ) noexcept {
+
+        const size_t row_bytes = static_cast<size_t>(tile.dst_w) * plan.dst_format.bytes;
+        const size_t plane_bytes = row_bytes * tile.dst_h;
+
+        for (int plane = 0; plane < plan.dst_planes; ++plane) {
+            copyPlane(
+                io.dst_ptrs[plane] + dstOffset(plan, tile, io.dst_stride), io.dst_stride,
+                &slot.dst[plane * plane_bytes], row_bytes,
+                row_bytes, tile.dst_h
+            );
+        }
+    }
+};
+
+#endif // VSMLRT_COMMON_TILE_CACHE_H_
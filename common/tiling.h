@@ -0,0 +1,1095 @@
+#ifndef VSMLRT_COMMON_TILING_H_
+#define VSMLRT_COMMON_TILING_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <VapourSynth.h>
+
+#include "copy_kernels.h"
+
+// A tile plan is computed once per filter instance and describes how a frame
+// is split into overlapping tiles and how the cropped output of each tile is
+// placed into the destination frame.
+//
+// By default all tiles have the same size and the last row and column of tiles
+// are shifted back to be aligned with the frame border. With a positive
+// `edge_alignment`, they are shrunk instead, so that each distinct edge tile
+// shape requires its own network.
+//
+// Tiles may also be larger than the frame if a padding mode is set. The part
+// of such a tile outside the frame is filled while packing and the
+// corresponding output is dropped.
+//
+// With a blend mode, overlapping tiles are not cropped. Their outputs are
+// weighted by separable windows that ramp over the overlapping region and are
+// accumulated into the destination frame, which must be 32-bit float.
+
+struct Tile {
+    // origin of the input tile in the source frame
+    int src_x;
+    int src_y;
+
+    // size of the part of the input tile inside the source frame
+    int src_w;
+    int src_h;
+
+    // region of the destination frame written by this tile,
+    // regions of different tiles never intersect
+    int dst_x;
+    int dst_y;
+    int dst_w;
+    int dst_h;
+
+    // byte offset of (dst_x, dst_y) inside a plane of the output tile
+    size_t out_offset;
+
+    // index into TilePlan::shapes
+    int shape;
+
+    // indices into TilePlan::column_weights and TilePlan::row_weights,
+    // as well as TilePlan::column_taps and TilePlan::row_taps
+    int column;
+    int row;
+};
+
+// how the part of a tile outside the source frame is filled
+enum class Padding { None, Zero, Replicate, Reflect };
+
+static inline
+std::optional<Padding> parsePadding(const char * mode) noexcept {
+    if (std::strcmp(mode, "zero") == 0) {
+        return Padding::Zero;
+    } else if (std::strcmp(mode, "replicate") == 0) {
+        return Padding::Replicate;
+    } else if (std::strcmp(mode, "reflect") == 0) {
+        return Padding::Reflect;
+    }
+
+    return {};
+}
+
+// window of the overlapping region of blended tiles
+enum class Blend { None, Linear, Cosine };
+
+static inline
+std::optional<Blend> parseBlend(const char * mode) noexcept {
+    if (std::strcmp(mode, "linear") == 0) {
+        return Blend::Linear;
+    } else if (std::strcmp(mode, "cosine") == 0) {
+        return Blend::Cosine;
+    }
+
+    return {};
+}
+
+// tiles of the same size, the full tiles are always the first shape
+struct TileShape {
+    int tile_w;
+    int tile_h;
+
+    // number of tiles of a frame
+    int count;
+
+    // maximum number of tiles per inference
+    int batch;
+
+    int dst_tile_w;
+    int dst_tile_h;
+
+    size_t src_tile_w_bytes;
+    size_t src_tile_bytes; // per plane
+    size_t dst_tile_w_bytes;
+    size_t dst_tile_bytes; // per plane
+
+    // distance between adjacent tiles of a batched tensor
+    size_t src_batch_stride;
+    size_t dst_batch_stride;
+};
+
+// consecutive tiles of the same shape that are inferred together
+// in a single NCHW tensor
+struct TileBatch {
+    int first;
+    int count;
+    int shape;
+};
+
+// sample type of frame planes, integer samples are normalized to [0, 1]
+// in the tensors
+struct SampleFormat {
+    bool is_float;
+    int bits;
+    int bytes;
+};
+
+static inline
+SampleFormat getSampleFormat(const VSFormat * format) noexcept {
+    return SampleFormat {
+        format->sampleType == stFloat,
+        format->bitsPerSample,
+        format->bytesPerSample
+    };
+}
+
+// a sample of a row, integer samples are multiplied by `scale`
+static inline
+float normalizedSample(const uint8_t * row, int x, const SampleFormat & format, float scale) noexcept {
+    if (format.is_float) {
+        if (format.bytes == 2) {
+            return halfToFloat(reinterpret_cast<const uint16_t *>(row)[x]);
+        }
+        return reinterpret_cast<const float *>(row)[x];
+    } else if (format.bytes == 1) {
+        return row[x] * scale;
+    } else {
+        return reinterpret_cast<const uint16_t *>(row)[x] * scale;
+    }
+}
+
+// the values of the scalar channels last written into each slot of the
+// input tensors, so that a slot is only filled again if they change
+struct ScalarChannelCache {
+    std::mutex mutex;
+    std::unordered_map<const uint8_t *, std::vector<float>> values;
+};
+
+// source and destination planes of a frame
+struct FrameIO {
+    const uint8_t * const * src_ptrs;
+    int src_stride;
+    uint8_t * const * dst_ptrs;
+    int dst_stride;
+
+    // serializes the blending of tiles that are unpacked concurrently
+    std::mutex * blend_mutex {};
+
+    // values of the scalar channels of the frame
+    const float * scalars {};
+    ScalarChannelCache * scalar_cache {};
+};
+
+// a tile of a particular frame
+struct TileJob {
+    const Tile * tile;
+    const FrameIO * io;
+
+    // receives a copy of the output tensor of the tile if not null
+    uint8_t * output_copy {};
+};
+
+// the source samples of a sample of a dimension upscaled by `scale` and
+// their bicubic (b = 0, c = 0.75) weights as in cv2.INTER_CUBIC,
+// sample centers are aligned and the source is mirrored at its edges,
+// repeating the border sample as core.resize.Bicubic does
+using CubicTaps = std::array<std::pair<int, float>, 4>;
+
+static inline
+CubicTaps cubicTaps(int pos, int scale, int size) noexcept {
+    const float center = (pos + 0.5f) / scale - 0.5f;
+    const int first = static_cast<int>(std::floor(center)) - 1;
+
+    CubicTaps taps;
+    for (int i = 0; i < 4; ++i) {
+        int index = first + i;
+
+        float d = std::fabs(center - index);
+        float weight = (d < 1.f) ? (
+            (1.25f * d - 2.25f) * d * d + 1.f
+        ) : (
+            ((-0.75f * d + 3.75f) * d - 6.f) * d + 3.f
+        );
+
+        if (index < 0) {
+            index = -index - 1;
+        } else if (index >= size) {
+            index = 2 * size - index - 1;
+        }
+
+        taps[i] = { std::clamp(index, 0, size - 1), weight };
+    }
+
+    return taps;
+}
+
+// the taps of the upscaled samples of a column or row of tiles and the
+// range of source samples they read
+struct PrescaleTaps {
+    std::vector<CubicTaps> taps;
+    int first;
+    int last;
+};
+
+static inline
+PrescaleTaps prescaleTaps(int origin, int count, int scale, int size) noexcept {
+    PrescaleTaps result { std::vector<CubicTaps>(count), size - 1, 0 };
+
+    for (int i = 0; i < count; ++i) {
+        result.taps[i] = cubicTaps(origin + i, scale, size);
+        for (const auto & [index, weight] : result.taps[i]) {
+            result.first = std::min(result.first, index);
+            result.last = std::max(result.last, index);
+        }
+    }
+
+    return result;
+}
+
+struct TilePlan {
+    int src_width;
+    int src_height;
+    int src_planes;
+    SampleFormat src_format;
+
+    // input channels of a single value per frame that follow the source
+    // planes in the tensor
+    int scalar_channels;
+
+    // factor of a bicubic upscale of the source planes that is computed
+    // while packing, the source dimensions are those of the upscaled planes
+    int prescale;
+
+    int dst_planes;
+    SampleFormat dst_format;
+
+    // bytes per tensor element, 4 for fp32 and 2 for fp16
+    int tensor_bytes;
+
+    Padding padding;
+
+    // none if the frame is a single tile
+    Blend blend;
+
+    int tile_w;
+    int tile_h;
+    int overlap_w;
+    int overlap_h;
+    int w_scale;
+    int h_scale;
+
+    // sizes of the full tiles, same as shapes[0]
+    int dst_tile_w;
+    int dst_tile_h;
+
+    size_t src_tile_w_bytes;
+    size_t src_tile_bytes; // per plane
+    size_t dst_tile_w_bytes;
+    size_t dst_tile_bytes; // per plane
+
+    int batch;
+
+    size_t src_batch_stride;
+    size_t dst_batch_stride;
+
+    std::vector<TileShape> shapes;
+
+    // input samples per plane and frame that shrunk edge tiles save
+    // compared to shifted ones
+    size_t saved_pixels;
+
+    // sorted by shape
+    std::vector<Tile> tiles;
+    std::vector<TileBatch> batches;
+
+    // normalized blend weights of the output samples of each column and
+    // row of tiles, the weights of all tiles covering a sample sum up to 1
+    std::vector<std::vector<float>> column_weights;
+    std::vector<std::vector<float>> row_weights;
+
+    // bicubic taps of each column and row of tiles if `prescale` > 1
+    std::vector<PrescaleTaps> column_taps;
+    std::vector<PrescaleTaps> row_taps;
+};
+
+// origin and size of the tiles along one dimension, the last tile is either
+// shifted back or shrunk to the smallest multiple of `edge_alignment`
+// to be aligned with the frame border
+//
+// A single tile larger than the frame is only shrunk to the smallest multiple
+// of `edge_alignment` that covers the frame.
+static inline
+std::vector<std::pair<int, int>> tileSpans(
+    int size,
+    int tile_size,
+    int step,
+    int edge_alignment
+) noexcept {
+
+    std::vector<std::pair<int, int>> spans;
+
+    if (tile_size > size) {
+        int edge = tile_size;
+        if (edge_alignment > 0) {
+            edge = (size + edge_alignment - 1) / edge_alignment * edge_alignment;
+            edge = std::min(edge, tile_size);
+        }
+        spans.emplace_back(0, edge);
+        return spans;
+    }
+
+    int pos = 0;
+    while (true) {
+        spans.emplace_back(pos, tile_size);
+
+        if (pos + tile_size >= size) {
+            break;
+        }
+
+        int next = pos + step;
+        if (next + tile_size > size) {
+            int edge = tile_size;
+            if (edge_alignment > 0) {
+                edge = (size - next + edge_alignment - 1) / edge_alignment * edge_alignment;
+                edge = std::min(edge, tile_size);
+            }
+            spans.emplace_back(size - edge, edge);
+            break;
+        }
+
+        pos = next;
+    }
+
+    return spans;
+}
+
+// [begin, end) of the destination written by each tile along one dimension
+//
+// Every tile but the first drops `overlap` output samples at its start and
+// every tile but the last drops `overlap` output samples at its end,
+// and the remaining overlap is resolved in favor of the later tile.
+// Output samples beyond the scaled `size` of the frame are dropped as well.
+// Blended tiles keep their whole output instead.
+static inline
+std::vector<std::pair<int, int>> tileExtents(
+    const std::vector<std::pair<int, int>> & spans,
+    int size,
+    int overlap,
+    int scale,
+    bool blend = false
+) noexcept {
+
+    const int num_tiles = static_cast<int>(std::size(spans));
+    const int crop = blend ? 0 : overlap;
+
+    std::vector<std::pair<int, int>> extents;
+    extents.reserve(num_tiles);
+
+    for (int i = 0; i < num_tiles; ++i) {
+        const auto & [origin, tile_size] = spans[i];
+        int begin = scale * origin + ((i == 0) ? 0 : crop);
+        int end = scale * (origin + tile_size) - ((i == num_tiles - 1) ? 0 : crop);
+        end = std::min(end, scale * size);
+        extents.emplace_back(begin, end);
+    }
+
+    if (!blend) {
+        for (int i = 0; i < num_tiles - 1; ++i) {
+            extents[i].second = std::min(extents[i].second, extents[i + 1].first);
+        }
+    }
+
+    return extents;
+}
+
+// blend weights of the output samples of each tile along one dimension
+//
+// A tile ramps up over the `2 * overlap` scaled samples it shares with its
+// predecessor and down over those it shares with its successor. The weights
+// are normalized by their sum, which also covers shifted edge tiles that
+// overlap more than one neighbour.
+static inline
+std::vector<std::vector<float>> tileWeights(
+    const std::vector<std::pair<int, int>> & extents,
+    int overlap,
+    int scale,
+    Blend blend
+) noexcept {
+
+    constexpr float pi = 3.14159265358979f;
+
+    const int num_tiles = static_cast<int>(std::size(extents));
+    const float ramp = static_cast<float>(2 * overlap * scale);
+
+    const auto window = [ramp, blend](float distance) {
+        if (distance >= ramp) {
+            return 1.f;
+        }
+
+        float t = distance / ramp;
+        return (blend == Blend::Linear) ? t : 0.5f - 0.5f * std::cos(pi * t);
+    };
+
+    std::vector<std::vector<float>> weights(num_tiles);
+    std::vector<float> sums(extents.back().second);
+
+    for (int i = 0; i < num_tiles; ++i) {
+        const auto & [begin, end] = extents[i];
+        weights[i].resize(end - begin);
+
+        for (int x = begin; x < end; ++x) {
+            // sample centers never lie on the tile border
+            float weight = 1.f;
+            if (i > 0) {
+                weight *= window(static_cast<float>(x - begin) + 0.5f);
+            }
+            if (i < num_tiles - 1) {
+                weight *= window(static_cast<float>(end - x) - 0.5f);
+            }
+
+            weights[i][x - begin] = weight;
+            sums[x] += weight;
+        }
+    }
+
+    for (int i = 0; i < num_tiles; ++i) {
+        const int begin = extents[i].first;
+        for (int x = 0; x < static_cast<int>(std::size(weights[i])); ++x) {
+            weights[i][x] /= sums[begin + x];
+        }
+    }
+
+    return weights;
+}
+
+static inline
+int numTiles(
+    int src_width, int src_height,
+    int tile_w, int tile_h,
+    int overlap_w, int overlap_h
+) noexcept {
+
+    auto num_tiles_w = std::size(tileSpans(src_width, tile_w, tile_w - 2 * overlap_w, 0));
+    auto num_tiles_h = std::size(tileSpans(src_height, tile_h, tile_h - 2 * overlap_h, 0));
+
+    return static_cast<int>(num_tiles_w * num_tiles_h);
+}
+
+// distinct tile sizes along one dimension, the full size first
+static inline
+std::vector<int> tileSizes(
+    const std::vector<std::pair<int, int>> & spans
+) noexcept {
+
+    std::vector<int> sizes;
+    for (const auto & [_, size] : spans) {
+        if (std::find(std::cbegin(sizes), std::cend(sizes), size) == std::cend(sizes)) {
+            sizes.push_back(size);
+        }
+    }
+
+    return sizes;
+}
+
+// the shapes of the tiles of a frame without their byte sizes,
+// ordered by height and then by width
+//
+// The full tiles are batched by `batch`, while the batch of the edge tiles is
+// limited to their number per frame.
+static inline
+std::vector<TileShape> tileShapes(
+    int src_width, int src_height,
+    int tile_w, int tile_h,
+    int overlap_w, int overlap_h,
+    int batch,
+    int edge_alignment
+) noexcept {
+
+    const auto xs = tileSpans(src_width, tile_w, tile_w - 2 * overlap_w, edge_alignment);
+    const auto ys = tileSpans(src_height, tile_h, tile_h - 2 * overlap_h, edge_alignment);
+
+    const auto count = [](const auto & spans, int size) {
+        return static_cast<int>(std::count_if(
+            std::cbegin(spans), std::cend(spans),
+            [size](const auto & span) { return span.second == size; }
+        ));
+    };
+
+    std::vector<TileShape> shapes;
+    for (int h : tileSizes(ys)) {
+        for (int w : tileSizes(xs)) {
+            TileShape shape {};
+            shape.tile_w = w;
+            shape.tile_h = h;
+            shape.count = count(xs, w) * count(ys, h);
+            shape.batch = std::empty(shapes) ? batch : std::min(batch, shape.count);
+            shapes.push_back(shape);
+        }
+    }
+
+    return shapes;
+}
+
+// splits `count` tiles that are sorted by shape into batches of at most
+// the batch size of their shape
+template <typename F>
+static inline
+std::vector<TileBatch> makeBatches(
+    const std::vector<TileShape> & shapes,
+    int count,
+    F && shape_of
+) noexcept {
+
+    std::vector<TileBatch> batches;
+
+    for (int first = 0; first < count; ) {
+        const int shape = shape_of(first);
+        const int shape_batch = shapes[shape].batch;
+
+        int size = 1;
+        while (size < shape_batch && first + size < count && shape_of(first + size) == shape) {
+            ++size;
+        }
+
+        batches.push_back(TileBatch { first, size, shape });
+        first += size;
+    }
+
+    return batches;
+}
+
+static inline
+TilePlan makeTilePlan(
+    int src_width, int src_height, int src_planes, SampleFormat src_format,
+    int dst_planes, SampleFormat dst_format,
+    int tile_w, int tile_h,
+    int overlap_w, int overlap_h,
+    int w_scale, int h_scale,
+    int batch = 1,
+    int tensor_bytes = sizeof(float),
+    int edge_alignment = 0,
+    Padding padding = Padding::None,
+    Blend blend = Blend::None,
+    int scalar_channels = 0,
+    int prescale = 1
+) noexcept {
+
+    TilePlan plan {};
+
+    plan.src_width = src_width;
+    plan.src_height = src_height;
+    plan.src_planes = src_planes;
+    plan.src_format = src_format;
+    plan.scalar_channels = scalar_channels;
+    plan.prescale = prescale;
+    plan.dst_planes = dst_planes;
+    plan.dst_format = dst_format;
+    plan.tensor_bytes = tensor_bytes;
+    plan.padding = padding;
+    plan.tile_w = tile_w;
+    plan.tile_h = tile_h;
+    plan.overlap_w = overlap_w;
+    plan.overlap_h = overlap_h;
+    plan.w_scale = w_scale;
+    plan.h_scale = h_scale;
+    plan.shapes = tileShapes(
+        src_width, src_height, tile_w, tile_h, overlap_w, overlap_h, batch, edge_alignment
+    );
+    for (auto & shape : plan.shapes) {
+        shape.dst_tile_w = shape.tile_w * w_scale;
+        shape.dst_tile_h = shape.tile_h * h_scale;
+
+        shape.src_tile_w_bytes = static_cast<size_t>(shape.tile_w) * tensor_bytes;
+        shape.src_tile_bytes = shape.tile_h * shape.src_tile_w_bytes;
+        shape.dst_tile_w_bytes = static_cast<size_t>(shape.dst_tile_w) * tensor_bytes;
+        shape.dst_tile_bytes = shape.dst_tile_h * shape.dst_tile_w_bytes;
+
+        shape.src_batch_stride = (src_planes + scalar_channels) * shape.src_tile_bytes;
+        shape.dst_batch_stride = dst_planes * shape.dst_tile_bytes;
+    }
+
+    const auto & full = plan.shapes[0];
+    plan.dst_tile_w = full.dst_tile_w;
+    plan.dst_tile_h = full.dst_tile_h;
+    plan.src_tile_w_bytes = full.src_tile_w_bytes;
+    plan.src_tile_bytes = full.src_tile_bytes;
+    plan.dst_tile_w_bytes = full.dst_tile_w_bytes;
+    plan.dst_tile_bytes = full.dst_tile_bytes;
+    plan.batch = full.batch;
+    plan.src_batch_stride = full.src_batch_stride;
+    plan.dst_batch_stride = full.dst_batch_stride;
+
+    const auto xs = tileSpans(src_width, tile_w, tile_w - 2 * overlap_w, edge_alignment);
+    const auto ys = tileSpans(src_height, tile_h, tile_h - 2 * overlap_h, edge_alignment);
+    if (std::size(xs) * std::size(ys) == 1) {
+        blend = Blend::None;
+    }
+    plan.blend = blend;
+
+    const bool blended = blend != Blend::None;
+    const auto x_extents = tileExtents(xs, src_width, overlap_w, w_scale, blended);
+    const auto y_extents = tileExtents(ys, src_height, overlap_h, h_scale, blended);
+    if (blended) {
+        plan.column_weights = tileWeights(x_extents, overlap_w, w_scale, blend);
+        plan.row_weights = tileWeights(y_extents, overlap_h, h_scale, blend);
+    }
+    if (prescale > 1) {
+        for (const auto & [origin, size] : xs) {
+            plan.column_taps.push_back(prescaleTaps(
+                origin, std::min(size, src_width - origin), prescale, src_width / prescale
+            ));
+        }
+        for (const auto & [origin, size] : ys) {
+            plan.row_taps.push_back(prescaleTaps(
+                origin, std::min(size, src_height - origin), prescale, src_height / prescale
+            ));
+        }
+    }
+    const auto widths = tileSizes(xs);
+    const auto heights = tileSizes(ys);
+
+    const auto index = [](const std::vector<int> & sizes, int size) {
+        return static_cast<int>(std::find(std::cbegin(sizes), std::cend(sizes), size) - std::cbegin(sizes));
+    };
+
+    plan.tiles.reserve(std::size(xs) * std::size(ys));
+    for (size_t j = 0; j < std::size(ys); ++j) {
+        for (size_t i = 0; i < std::size(xs); ++i) {
+            Tile tile {};
+            tile.src_x = xs[i].first;
+            tile.src_y = ys[j].first;
+            tile.src_w = std::min(xs[i].second, src_width - tile.src_x);
+            tile.src_h = std::min(ys[j].second, src_height - tile.src_y);
+            tile.dst_x = x_extents[i].first;
+            tile.dst_y = y_extents[j].first;
+            tile.dst_w = x_extents[i].second - x_extents[i].first;
+            tile.dst_h = y_extents[j].second - y_extents[j].first;
+            tile.shape = (
+                index(heights, ys[j].second) * static_cast<int>(std::size(widths)) +
+                index(widths, xs[i].second)
+            );
+            tile.column = static_cast<int>(i);
+            tile.row = static_cast<int>(j);
+
+            auto out_x = tile.dst_x - w_scale * tile.src_x;
+            auto out_y = tile.dst_y - h_scale * tile.src_y;
+            tile.out_offset = (
+                out_y * plan.shapes[tile.shape].dst_tile_w_bytes +
+                out_x * static_cast<size_t>(tensor_bytes)
+            );
+
+            plan.tiles.push_back(tile);
+        }
+    }
+
+    std::stable_sort(
+        std::begin(plan.tiles), std::end(plan.tiles),
+        [](const Tile & a, const Tile & b) { return a.shape < b.shape; }
+    );
+
+    const size_t full_pixels = static_cast<size_t>(tile_w) * tile_h * std::size(plan.tiles);
+    size_t pixels = 0;
+    for (const auto & shape : plan.shapes) {
+        pixels += static_cast<size_t>(shape.tile_w) * shape.tile_h * shape.count;
+    }
+    plan.saved_pixels = full_pixels - pixels;
+
+    plan.batches = makeBatches(
+        plan.shapes, static_cast<int>(std::size(plan.tiles)),
+        [&plan](int i) { return plan.tiles[i].shape; }
+    );
+
+    return plan;
+}
+
+// whether a tile extends beyond the source frame
+static inline
+bool isPadded(const TilePlan & plan, const Tile & tile) noexcept {
+    const auto & shape = plan.shapes[tile.shape];
+    return tile.src_w < shape.tile_w || tile.src_h < shape.tile_h;
+}
+
+// fills the samples of a packed tile that lie outside the source frame,
+// reflection does not repeat the border sample
+static inline
+void padTile(
+    const TilePlan & plan,
+    const Tile & tile,
+    uint8_t * tensor
+) noexcept {
+
+    const auto & shape = plan.shapes[tile.shape];
+    const size_t bytes = plan.tensor_bytes;
+    const size_t stride = shape.src_tile_w_bytes;
+
+    // the sample inside [0, size) that is copied to pos >= size
+    const auto source = [&plan](int pos, int size) {
+        if (plan.padding == Padding::Replicate || size == 1) {
+            return size - 1;
+        }
+
+        const int period = 2 * (size - 1);
+        pos %= period;
+        return (pos < size) ? pos : period - pos;
+    };
+
+    for (int plane = 0; plane < plan.src_planes; ++plane) {
+        uint8_t * planep = tensor + plane * shape.src_tile_bytes;
+
+        if (tile.src_w < shape.tile_w) {
+            for (int y = 0; y < tile.src_h; ++y) {
+                uint8_t * row = planep + y * stride;
+
+                if (plan.padding == Padding::Zero) {
+                    std::memset(row + tile.src_w * bytes, 0, (shape.tile_w - tile.src_w) * bytes);
+                } else {
+                    for (int x = tile.src_w; x < shape.tile_w; ++x) {
+                        std::memcpy(row + x * bytes, row + source(x, tile.src_w) * bytes, bytes);
+                    }
+                }
+            }
+        }
+
+        for (int y = tile.src_h; y < shape.tile_h; ++y) {
+            uint8_t * row = planep + y * stride;
+
+            if (plan.padding == Padding::Zero) {
+                std::memset(row, 0, stride);
+            } else {
+                std::memcpy(row, planep + source(y, tile.src_h) * stride, stride);
+            }
+        }
+    }
+}
+
+// packs the input region of a tile of the upscaled source planes,
+// computing only the upscaled samples of the tile
+static inline
+void prescaleTile(
+    const TilePlan & plan,
+    const Tile & tile,
+    const uint8_t * const * src_ptrs,
+    int src_stride,
+    uint8_t * tensor
+) noexcept {
+
+    const auto & shape = plan.shapes[tile.shape];
+    const float scale = (
+        plan.src_format.is_float ? 1.f : 1.f / static_cast<float>((1 << plan.src_format.bits) - 1)
+    );
+
+    const auto & xtaps = plan.column_taps[tile.column].taps;
+    const auto & ytaps = plan.row_taps[tile.row].taps;
+    const int first = plan.column_taps[tile.column].first;
+    const int last = plan.column_taps[tile.column].last;
+
+    // the source columns of the tile filtered vertically, followed by a row
+    // of the tile, kept per thread to not allocate per tile
+    thread_local std::vector<float> buffer;
+    buffer.resize(static_cast<size_t>(last - first + 1) + tile.src_w);
+    float * columns = std::data(buffer);
+    float * row = columns + (last - first + 1);
+
+    for (int plane = 0; plane < plan.src_planes; ++plane) {
+        uint8_t * planep = tensor + plane * shape.src_tile_bytes;
+
+        for (int y = 0; y < tile.src_h; ++y) {
+            for (int x = first; x <= last; ++x) {
+                float sum = 0.f;
+                for (const auto & [index, weight] : ytaps[y]) {
+                    const uint8_t * srcp = src_ptrs[plane] + static_cast<size_t>(index) * src_stride;
+                    sum += weight * normalizedSample(srcp, x, plan.src_format, scale);
+                }
+                columns[x - first] = sum;
+            }
+
+            for (int x = 0; x < tile.src_w; ++x) {
+                float sum = 0.f;
+                for (const auto & [index, weight] : xtaps[x]) {
+                    sum += weight * columns[index - first];
+                }
+                row[x] = sum;
+            }
+
+            uint8_t * dstp = planep + y * shape.src_tile_w_bytes;
+            if (plan.tensor_bytes == sizeof(float)) {
+                std::memcpy(dstp, row, tile.src_w * sizeof(float));
+            } else {
+                toHalfRow(reinterpret_cast<uint16_t *>(dstp), row, tile.src_w, 1.f);
+            }
+        }
+    }
+}
+
+// copies the input region of a tile from all source planes into a NCHW tensor,
+// half float frames require fp16 tensors
+static inline
+void packTile(
+    const TilePlan & plan,
+    const Tile & tile,
+    const uint8_t * const * src_ptrs,
+    int src_stride,
+    uint8_t * tensor
+) noexcept {
+
+    const size_t offset = (
+        static_cast<size_t>(tile.src_y) * src_stride +
+        static_cast<size_t>(tile.src_x) * plan.src_format.bytes
+    );
+
+    const auto & shape = plan.shapes[tile.shape];
+    const auto & kernels = getCopyKernels();
+
+    if (plan.prescale > 1) {
+        prescaleTile(plan, tile, src_ptrs, src_stride, tensor);
+    } else if (plan.src_format.is_float && plan.src_format.bytes == plan.tensor_bytes) {
+        kernels.gather(
+            tensor, shape.src_tile_w_bytes, shape.src_tile_bytes,
+            src_ptrs, offset, src_stride,
+            static_cast<size_t>(tile.src_w) * plan.tensor_bytes, tile.src_h, plan.src_planes
+        );
+    } else if (plan.tensor_bytes == sizeof(float)) {
+        kernels.gather_int(
+            tensor, shape.src_tile_w_bytes, shape.src_tile_bytes,
+            src_ptrs, offset, src_stride,
+            tile.src_w, tile.src_h, plan.src_planes,
+            plan.src_format.bytes, plan.src_format.bits
+        );
+    } else {
+        kernels.gather_half(
+            tensor, shape.src_tile_w_bytes, shape.src_tile_bytes,
+            src_ptrs, offset, src_stride,
+            tile.src_w, tile.src_h, plan.src_planes,
+            plan.src_format.bytes, plan.src_format.bits
+        );
+    }
+
+    if (isPadded(plan, tile)) {
+        padTile(plan, tile, tensor);
+    }
+}
+
+// zeroes the destination planes that blended tiles are accumulated into
+static inline
+void clearBlendTarget(
+    const TilePlan & plan,
+    uint8_t * const * dst_ptrs,
+    int dst_stride
+) noexcept {
+
+    if (plan.blend == Blend::None) {
+        return;
+    }
+
+    const size_t row_bytes = static_cast<size_t>(plan.src_width) * plan.w_scale * sizeof(float);
+    const int height = plan.src_height * plan.h_scale;
+
+    for (int plane = 0; plane < plan.dst_planes; ++plane) {
+        for (int y = 0; y < height; ++y) {
+            std::memset(dst_ptrs[plane] + static_cast<size_t>(y) * dst_stride, 0, row_bytes);
+        }
+    }
+}
+
+template <typename T>
+static inline
+void blendRow(float * dst, const T * src, const float * weights, float weight, int width) noexcept {
+    for (int x = 0; x < width; ++x) {
+        float v;
+        if constexpr (std::is_same_v<T, uint16_t>) {
+            v = halfToFloat(src[x]);
+        } else {
+            v = src[x];
+        }
+        dst[x] += weight * weights[x] * v;
+    }
+}
+
+// accumulates the weighted output of a tile into all destination planes
+static inline
+void blendTile(
+    const TilePlan & plan,
+    const Tile & tile,
+    const uint8_t * tensor,
+    uint8_t * const * dst_ptrs,
+    int dst_stride
+) noexcept {
+
+    const auto & shape = plan.shapes[tile.shape];
+    const float * column_weights = std::data(plan.column_weights[tile.column]);
+    const auto & row_weights = plan.row_weights[tile.row];
+
+    for (int plane = 0; plane < plan.dst_planes; ++plane) {
+        for (int y = 0; y < tile.dst_h; ++y) {
+            auto dstp = reinterpret_cast<float *>(
+                dst_ptrs[plane] + static_cast<size_t>(tile.dst_y + y) * dst_stride
+            ) + tile.dst_x;
+            const uint8_t * srcp = (
+                tensor + plane * shape.dst_tile_bytes + tile.out_offset +
+                y * shape.dst_tile_w_bytes
+            );
+
+            if (plan.tensor_bytes == sizeof(float)) {
+                blendRow(
+                    dstp, reinterpret_cast<const float *>(srcp),
+                    column_weights, row_weights[y], tile.dst_w
+                );
+            } else {
+                blendRow(
+                    dstp, reinterpret_cast<const uint16_t *>(srcp),
+                    column_weights, row_weights[y], tile.dst_w
+                );
+            }
+        }
+    }
+}
+
+// copies the cropped output of a tile from a NCHW tensor into all destination planes,
+// or blends it into them
+static inline
+void unpackTile(
+    const TilePlan & plan,
+    const Tile & tile,
+    const uint8_t * tensor,
+    uint8_t * const * dst_ptrs,
+    int dst_stride
+) noexcept {
+
+    if (plan.blend != Blend::None) {
+        blendTile(plan, tile, tensor, dst_ptrs, dst_stride);
+        return;
+    }
+
+    const size_t offset = (
+        static_cast<size_t>(tile.dst_y) * dst_stride +
+        static_cast<size_t>(tile.dst_x) * plan.dst_format.bytes
+    );
+
+    const auto & shape = plan.shapes[tile.shape];
+    const auto & kernels = getCopyKernels();
+
+    if (plan.dst_format.is_float && plan.dst_format.bytes == plan.tensor_bytes) {
+        kernels.scatter(
+            dst_ptrs, offset, dst_stride,
+            tensor + tile.out_offset, shape.dst_tile_w_bytes, shape.dst_tile_bytes,
+            static_cast<size_t>(tile.dst_w) * plan.tensor_bytes, tile.dst_h, plan.dst_planes
+        );
+    } else if (plan.tensor_bytes == sizeof(float)) {
+        kernels.scatter_int(
+            dst_ptrs, offset, dst_stride,
+            tensor + tile.out_offset, shape.dst_tile_w_bytes, shape.dst_tile_bytes,
+            tile.dst_w, tile.dst_h, plan.dst_planes,
+            plan.dst_format.bytes, plan.dst_format.bits
+        );
+    } else {
+        kernels.scatter_half(
+            dst_ptrs, offset, dst_stride,
+            tensor + tile.out_offset, shape.dst_tile_w_bytes, shape.dst_tile_bytes,
+            tile.dst_w, tile.dst_h, plan.dst_planes,
+            plan.dst_format.bytes, plan.dst_format.bits
+        );
+    }
+}
+
+// fills the scalar channels of a packed tile unless the slot holds
+// the same values already, zero padding is applied as to the source planes
+static inline
+void fillScalarChannels(
+    const TilePlan & plan,
+    const Tile & tile,
+    const FrameIO & io,
+    uint8_t * tensor
+) noexcept {
+
+    const float * values = io.scalars;
+    const int count = plan.scalar_channels;
+
+    // the valid region of zero padded tiles differs between tiles of a shape
+    const bool zero_padded = plan.padding == Padding::Zero && isPadded(plan, tile);
+
+    if (io.scalar_cache) {
+        std::lock_guard lock { io.scalar_cache->mutex };
+        auto & last = io.scalar_cache->values[tensor];
+        if (zero_padded) {
+            last.clear();
+        } else if (std::equal(std::cbegin(last), std::cend(last), values, values + count)) {
+            return;
+        } else {
+            last.assign(values, values + count);
+        }
+    }
+
+    const auto & shape = plan.shapes[tile.shape];
+
+    const auto fill = [&](auto * planep, auto value) {
+        for (int y = 0; y < shape.tile_h; ++y) {
+            auto row = planep + static_cast<size_t>(y) * shape.tile_w;
+            int valid = zero_padded ? (y < tile.src_h ? tile.src_w : 0) : shape.tile_w;
+            std::fill_n(row, valid, value);
+            std::fill_n(row + valid, shape.tile_w - valid, decltype(value) {});
+        }
+    };
+
+    for (int i = 0; i < count; ++i) {
+        uint8_t * planep = tensor + (plan.src_planes + i) * shape.src_tile_bytes;
+        if (plan.tensor_bytes == sizeof(float)) {
+            fill(reinterpret_cast<float *>(planep), values[i]);
+        } else {
+            fill(reinterpret_cast<uint16_t *>(planep), floatToHalf(values[i]));
+        }
+    }
+}
+
+// packs the tiles of a batch into consecutive slots of a NCHW tensor,
+// all tiles must have the same shape
+static inline
+void packBatch(
+    const TilePlan & plan,
+    const TileJob * jobs,
+    int count,
+    uint8_t * tensor
+) noexcept {
+
+    for (int i = 0; i < count; ++i) {
+        uint8_t * slot = tensor + i * plan.shapes[jobs[i].tile->shape].src_batch_stride;
+
+        packTile(plan, *jobs[i].tile, jobs[i].io->src_ptrs, jobs[i].io->src_stride, slot);
+
+        if (plan.scalar_channels > 0) {
+            fillScalarChannels(plan, *jobs[i].tile, *jobs[i].io, slot);
+        }
+    }
+}
+
+static inline
+void unpackBatch(
+    const TilePlan & plan,
+    const TileJob * jobs,
+    int count,
+    const uint8_t * tensor
+) noexcept {
+
+    for (int i = 0; i < count; ++i) {
+        const auto & shape = plan.shapes[jobs[i].tile->shape];
+
+        if (jobs[i].output_copy) {
+            std::memcpy(
+                jobs[i].output_copy,
+                tensor + i * shape.dst_batch_stride,
+                shape.dst_batch_stride
+            );
+        }
+
+        std::unique_lock<std::mutex> lock;
+        if (plan.blend != Blend::None && jobs[i].io->blend_mutex) {
+            lock = std::unique_lock { *jobs[i].io->blend_mutex };
+        }
+
+        unpackTile(
+            plan, *jobs[i].tile,
+            tensor + i * shape.dst_batch_stride,
+            jobs[i].io->dst_ptrs, jobs[i].io->dst_stride
+        );
+    }
+}
+
+#endif // VSMLRT_COMMON_TILING_H_
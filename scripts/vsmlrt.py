@@ -10,10 +10,13 @@ __all__ = [
 ]
 
 import copy
-from dataclasses import dataclass, field
+from dataclasses import dataclass, field, replace
 import enum
+import json
 import math
 import os
+import platform
+import random
 import subprocess
 import sys
 import tempfile
@@ -51,6 +54,28 @@ class Backend:
         num_streams: int = 1
         verbosity: int = 2
         fp16: bool = False
+        batch: int = 1
+        auto_overlap: bool = False # overrides the overlap of the model wrappers
+        edge_alignment: int = 0 # shrinks edge tiles if positive
+        padding: typing.Optional[str] = None # "zero", "replicate" or "reflect"
+        blend: typing.Optional[str] = None # "linear" or "cosine"
+        dynamic_batch: bool = False
+        batch_timeout: int = 1000 # in microseconds
+        latency_mode: bool = False
+        pipeline: bool = False
+        dedup: int = 0 # number of remembered frames whose output is reused
+        dedup_threshold: float = 0.0 # 0: exact comparison
+        tile_cache: bool = False
+        tile_cache_threshold: float = 0.0 # 0: exact comparison
+        constant_cache: int = 0 # number of cached outputs of constant tiles
+        roi: typing.Optional[typing.Tuple[int, int, int, int]] = None # left, top, width, height
+        mask: typing.Optional[vs.VideoNode] = None # GRAY, non-zero samples are inferred
+        shared_session: bool = False # all streams run a single session
+        global_threads: typing.Optional[int] = None # runs on the process-wide thread pool of this size, 0: physical cores
+        global_spin: typing.Optional[bool] = None
+        global_affinity: typing.Optional[str] = None
+        model_cache: typing.Optional[str] = None # directory of preprocessed and optimized models
+        fp16_io: bool = False
 
     @dataclass(frozen=False)
     class ORT_CUDA:
@@ -61,12 +86,48 @@ class Backend:
         verbosity: int = 2
         fp16: bool = False
         use_cuda_graph: bool = False # preview, not supported by all models
+        batch: int = 1
+        auto_overlap: bool = False # overrides the overlap of the model wrappers
+        edge_alignment: int = 0 # shrinks edge tiles if positive
+        padding: typing.Optional[str] = None # "zero", "replicate" or "reflect"
+        blend: typing.Optional[str] = None # "linear" or "cosine"
+        dynamic_batch: bool = False
+        batch_timeout: int = 1000 # in microseconds
+        latency_mode: bool = False
+        dedup: int = 0 # number of remembered frames whose output is reused
+        dedup_threshold: float = 0.0 # 0: exact comparison
+        tile_cache: bool = False
+        tile_cache_threshold: float = 0.0 # 0: exact comparison
+        constant_cache: int = 0 # number of cached outputs of constant tiles
+        roi: typing.Optional[typing.Tuple[int, int, int, int]] = None # left, top, width, height
+        mask: typing.Optional[vs.VideoNode] = None # GRAY, non-zero samples are inferred
+        shared_session: bool = False # all streams run a single session
+        global_threads: typing.Optional[int] = None # runs on the process-wide thread pool of this size, 0: physical cores
+        global_spin: typing.Optional[bool] = None
+        global_affinity: typing.Optional[str] = None
+        model_cache: typing.Optional[str] = None # directory of preprocessed and optimized models
+        fp16_io: bool = False
 
     @dataclass(frozen=False)
     class OV_CPU:
         fp16: bool = False
         num_streams: typing.Union[int, str] = 1
         bind_thread: bool = True
+        batch: int = 1
+        auto_overlap: bool = False # overrides the overlap of the model wrappers
+        edge_alignment: int = 0 # shrinks edge tiles if positive
+        padding: typing.Optional[str] = None # "zero", "replicate" or "reflect"
+        blend: typing.Optional[str] = None # "linear" or "cosine"
+        pipeline: bool = False
+        dedup: int = 0 # number of remembered frames whose output is reused
+        dedup_threshold: float = 0.0 # 0: exact comparison
+        tile_cache: bool = False
+        tile_cache_threshold: float = 0.0 # 0: exact comparison
+        constant_cache: int = 0 # number of cached outputs of constant tiles
+        roi: typing.Optional[typing.Tuple[int, int, int, int]] = None # left, top, width, height
+        mask: typing.Optional[vs.VideoNode] = None # GRAY, non-zero samples are inferred
+        model_cache: typing.Optional[str] = None # directory of preprocessed models
+        fp16_io: bool = False
 
     @dataclass(frozen=False)
     class TRT:
@@ -89,6 +150,9 @@ class Backend:
 
         use_edge_mask_convolutions: bool = True
 
+        padding: typing.Optional[str] = None # "zero", "replicate" or "reflect"
+        blend: typing.Optional[str] = None # "linear" or "cosine"
+
         _channels: int = field(init=False, repr=False, compare=False)
 
     @dataclass(frozen=False)
@@ -97,6 +161,41 @@ class Backend:
         fp16: bool = False
         num_streams: typing.Union[int, str] = 1
         device_id: int = 0
+        batch: int = 1
+        auto_overlap: bool = False # overrides the overlap of the model wrappers
+        edge_alignment: int = 0 # shrinks edge tiles if positive
+        padding: typing.Optional[str] = None # "zero", "replicate" or "reflect"
+        blend: typing.Optional[str] = None # "linear" or "cosine"
+        pipeline: bool = False
+        dedup: int = 0 # number of remembered frames whose output is reused
+        dedup_threshold: float = 0.0 # 0: exact comparison
+        tile_cache: bool = False
+        tile_cache_threshold: float = 0.0 # 0: exact comparison
+        constant_cache: int = 0 # number of cached outputs of constant tiles
+        roi: typing.Optional[typing.Tuple[int, int, int, int]] = None # left, top, width, height
+        mask: typing.Optional[vs.VideoNode] = None # GRAY, non-zero samples are inferred
+        model_cache: typing.Optional[str] = None # directory of preprocessed models
+        fp16_io: bool = False
+
+    @dataclass(frozen=False)
+    class AUTO:
+        """ times candidate configurations on synthetic input and uses the fastest one
+
+        The search is greedy: backend and fp16 first, then the number of tiles
+        per dimension, then num_streams. The result is cached on disk per model,
+        clip dimensions and cpu.
+        """
+        backends: typing.Tuple[typing.Any, ...] = field(
+            default_factory=lambda: (Backend.ORT_CPU(), Backend.OV_CPU())
+        )
+        fp16: typing.Tuple[bool, ...] = (False, True)
+        tiles: typing.Tuple[int, ...] = (1, 2, 4) # per dimension
+        num_streams: typing.Tuple[int, ...] = (1, 2, 4)
+        frames: int = 16 # timed frames per candidate
+        cache_path: typing.Optional[str] = None # defaults to the user cache directory
+
+        _channels: int = field(init=False, repr=False, compare=False)
+        _multiple: int = field(init=False, repr=False, compare=False)
 
 
 backendT = typing.Union[
@@ -104,7 +203,8 @@ backendT = typing.Union[
     Backend.ORT_CPU,
     Backend.ORT_CUDA,
     Backend.TRT,
-    Backend.OV_GPU
+    Backend.OV_GPU,
+    Backend.AUTO
 ]
 
 
@@ -177,16 +277,14 @@ def Waifu2x(
 
     width, height = clip.width, clip.height
     if preprocess and model in (0, 1, 2):
-        # emulating cv2.resize(interpolation=cv2.INTER_CUBIC)
-        clip = core.resize.Bicubic(
-            clip,
-            width * 2, height * 2,
-            filter_param_a=0, filter_param_b=0.75
-        )
+        # upscaled by the packer of the filter
+        prescale = 2
+    else:
+        prescale = 1
 
     (tile_w, tile_h), (overlap_w, overlap_h) = calc_tilesize(
         tiles=tiles, tilesize=tilesize,
-        width=clip.width, height=clip.height,
+        width=width * prescale, height=height * prescale,
         multiple=multiple,
         overlap_w=overlap_w, overlap_h=overlap_h
     )
@@ -204,7 +302,8 @@ def Waifu2x(
     backend = init_backend(
         backend=backend,
         channels=channels,
-        trt_max_shapes=(tile_w, tile_h)
+        trt_max_shapes=(tile_w, tile_h),
+        multiple=multiple
     )
 
     folder_path = os.path.join(
@@ -239,7 +338,7 @@ def Waifu2x(
     clip = inference_with_fallback(
         clips=[clip], network_path=network_path,
         overlap=(overlap_w, overlap_h), tilesize=(tile_w, tile_h),
-        backend=backend
+        backend=backend, prescale=prescale
     )
 
     if scale == 1 and clip.width // width == 2:
@@ -299,14 +398,17 @@ def DPIR(
         if strength.num_frames != clip.num_frames:
             raise ValueError(f'{func_name}: "strength" must be of the same length as "clip"')
 
-        strength = core.std.Expr(strength, "x 255 /", format=vs.GRAYS)
+        clips = [clip, core.std.Expr(strength, "x 255 /", format=vs.GRAYS)]
+        scalars = None
     else:
         try:
             strength = float(strength)
         except TypeError as e:
             raise TypeError(f'{func_name}: "strength" must be a float or a clip') from e
 
-        strength = core.std.BlankClip(clip, format=vs.GRAYS, color=strength / 255)
+        # filled into the input tensor instead of a noise level plane
+        clips = [clip]
+        scalars = [strength / 255]
 
     if overlap is None:
         overlap_w = overlap_h = 0
@@ -337,7 +439,8 @@ def DPIR(
     backend = init_backend(
         backend=backend,
         channels=channels,
-        trt_max_shapes=(tile_w, tile_h)
+        trt_max_shapes=(tile_w, tile_h),
+        multiple=multiple
     )
 
     network_path = os.path.join(
@@ -347,9 +450,9 @@ def DPIR(
     )
 
     clip = inference_with_fallback(
-        clips=[clip, strength], network_path=network_path,
+        clips=clips, network_path=network_path,
         overlap=(overlap_w, overlap_h), tilesize=(tile_w, tile_h),
-        backend=backend
+        backend=backend, scalars=scalars
     )
 
     return clip
@@ -410,7 +513,8 @@ def RealESRGAN(
     backend = init_backend(
         backend=backend,
         channels=channels,
-        trt_max_shapes=(tile_w, tile_h)
+        trt_max_shapes=(tile_w, tile_h),
+        multiple=multiple
     )
 
     if model in [0, 1]:
@@ -522,7 +626,8 @@ def CUGAN(
     backend = init_backend(
         backend=backend,
         channels=channels,
-        trt_max_shapes=(tile_w, tile_h)
+        trt_max_shapes=(tile_w, tile_h),
+        multiple=multiple
     )
 
     folder_path = os.path.join(models_path, "cugan")
@@ -824,7 +929,8 @@ def calc_tilesize(
 def init_backend(
     backend: backendT,
     channels: int,
-    trt_max_shapes: typing.Tuple[int, int]
+    trt_max_shapes: typing.Tuple[int, int],
+    multiple: int = 1
 ) -> backendT:
 
     if backend is Backend.ORT_CPU: # type: ignore
@@ -837,6 +943,8 @@ def init_backend(
         backend = Backend.TRT()
     elif backend is Backend.OV_GPU: # type: ignore
         backend = Backend.OV_GPU()
+    elif backend is Backend.AUTO: # type: ignore
+        backend = Backend.AUTO()
 
     backend = copy.deepcopy(backend)
 
@@ -849,18 +957,240 @@ def init_backend(
         if backend.opt_shapes is None:
             backend.opt_shapes = backend.max_shapes
 
+    if isinstance(backend, Backend.AUTO):
+        backend._channels = channels
+        backend._multiple = multiple
+
     return backend
 
 
+def get_cpu_name() -> str:
+    name = ""
+
+    if sys.platform.startswith("linux"):
+        try:
+            with open("/proc/cpuinfo") as file:
+                for line in file:
+                    if line.startswith("model name"):
+                        name = line.split(":", 1)[1].strip()
+                        break
+        except OSError:
+            pass
+
+    if not name:
+        name = platform.processor() or platform.machine()
+
+    return name.replace(' ', '-')
+
+
+def get_autotune_cache_path() -> str:
+    if sys.platform == "win32":
+        cache_dir = os.environ.get("LOCALAPPDATA", tempfile.gettempdir())
+    else:
+        cache_dir = os.environ.get(
+            "XDG_CACHE_HOME",
+            os.path.join(os.path.expanduser("~"), ".cache")
+        )
+
+    return os.path.join(cache_dir, "vsmlrt", "autotune.json")
+
+
+def synthetic_clip(clip: vs.VideoNode, length: int, seed: int = 0) -> vs.VideoNode:
+    """ smooth random frames of the format and dimensions of "clip" """
+
+    rng = random.Random(seed)
+
+    def color() -> typing.List[float]:
+        if clip.format.sample_type == vs.FLOAT:
+            return [rng.random() for _ in range(clip.format.num_planes)]
+        else:
+            peak = (1 << clip.format.bits_per_sample) - 1
+            return [rng.randint(0, peak) for _ in range(clip.format.num_planes)]
+
+    def block() -> vs.VideoNode:
+        return core.std.BlankClip(format=clip.format.id, width=1, height=1, length=1, color=color())
+
+    frames = []
+    for _ in range(length):
+        frame = core.std.StackVertical([
+            core.std.StackHorizontal([block(), block()]),
+            core.std.StackHorizontal([block(), block()])
+        ])
+        frames.append(core.resize.Bicubic(frame, clip.width, clip.height))
+
+    return core.std.Splice(frames)
+
+
+def autotune(
+    clips: typing.List[vs.VideoNode],
+    network_path: typing.Union[bytes, str],
+    overlap: typing.Tuple[int, int],
+    tilesize: typing.Tuple[int, int],
+    backend: Backend.AUTO,
+    path_is_serialization: bool = False,
+    scalars: typing.Optional[typing.List[float]] = None,
+    prescale: int = 1
+) -> typing.Tuple[backendT, typing.Tuple[int, int]]:
+
+    import logging
+    from concurrent.futures import ThreadPoolExecutor
+
+    logger = logging.getLogger("vsmlrt")
+
+    if path_is_serialization:
+        checksum = zlib.adler32(typing.cast(bytes, network_path))
+    else:
+        with open(network_path, "rb") as file:
+            checksum = zlib.adler32(file.read())
+
+    clip = clips[0]
+
+    # the dimensions seen by the network
+    width, height = clip.width * prescale, clip.height * prescale
+
+    # a different search space may find a different winner
+    search_space = repr((
+        [type(candidate).__name__ for candidate in backend.backends],
+        backend.fp16, backend.tiles, backend.num_streams
+    ))
+
+    key = "_".join((
+        f"{checksum:x}",
+        f"{width}x{height}",
+        clip.format.name,
+        f"overlap{overlap[0]}x{overlap[1]}",
+        f"tile{tilesize[0]}x{tilesize[1]}",
+        get_cpu_name(),
+        f"{zlib.adler32(search_space.encode()):x}"
+    ))
+
+    cache_path = backend.cache_path or get_autotune_cache_path()
+
+    try:
+        with open(cache_path) as file:
+            cache = json.load(file)
+    except (OSError, ValueError):
+        cache = {}
+
+    def configure(
+        name: str, fp16: bool, num_streams: int, tile: typing.Tuple[int, int]
+    ) -> typing.Tuple[backendT, typing.Tuple[int, int]]:
+
+        for candidate in backend.backends:
+            if type(candidate).__name__ == name:
+                candidate = replace(candidate, fp16=fp16, num_streams=num_streams)
+                candidate = init_backend(candidate, channels=backend._channels, trt_max_shapes=tile)
+                return candidate, tile
+
+        raise ValueError(f'unknown backend "{name}"')
+
+    if key in cache:
+        entry = cache[key]
+        return configure(entry["backend"], entry["fp16"], entry["num_streams"], tuple(entry["tilesize"]))
+
+    synthetic_clips = [synthetic_clip(c, backend.frames, seed=i) for i, c in enumerate(clips)]
+
+    def measure(name: str, fp16: bool, num_streams: int, tile: typing.Tuple[int, int]) -> float:
+        try:
+            candidate, tile = configure(name, fp16, num_streams, tile)
+            output = inference(
+                clips=synthetic_clips, network_path=network_path,
+                overlap=overlap, tilesize=tile,
+                backend=candidate,
+                path_is_serialization=path_is_serialization,
+                scalars=scalars, prescale=prescale
+            )
+
+            # excludes the initialization of the first frame
+            output.get_frame(0)
+
+            start = time.perf_counter()
+            with ThreadPoolExecutor(max_workers=core.num_threads) as executor:
+                list(executor.map(output.get_frame, range(1, backend.frames)))
+            elapsed = time.perf_counter() - start
+        except Exception as e:
+            logger.info(f"autotune: {name} fp16={fp16} num_streams={num_streams} tilesize={tile} fails: {e}")
+            return 0.0
+
+        fps = (backend.frames - 1) / elapsed
+        logger.info(f"autotune: {name} fp16={fp16} num_streams={num_streams} tilesize={tile}: {fps:.3f} fps")
+        return fps
+
+    multiple = backend._multiple
+    tiles = []
+    for num_tiles in backend.tiles:
+        tile = (
+            calc_size(width, num_tiles, overlap[0], multiple),
+            calc_size(height, num_tiles, overlap[1], multiple)
+        )
+        if tile[0] - 2 * overlap[0] > 0 and tile[1] - 2 * overlap[1] > 0 and tile not in tiles:
+            tiles.append(tile)
+
+    best = (0.0, "", False, backend.num_streams[0], tilesize)
+
+    for candidate in backend.backends:
+        name = type(candidate).__name__
+        for fp16 in backend.fp16:
+            fps = measure(name, fp16, best[3], best[4])
+            if fps > best[0]:
+                best = (fps, name, fp16, best[3], best[4])
+
+    if best[0] == 0.0:
+        raise RuntimeError("autotune: no candidate configuration works")
+
+    for tile in tiles:
+        if tile != best[4]:
+            fps = measure(best[1], best[2], best[3], tile)
+            if fps > best[0]:
+                best = (fps, best[1], best[2], best[3], tile)
+
+    for num_streams in backend.num_streams:
+        if num_streams != best[3]:
+            fps = measure(best[1], best[2], num_streams, best[4])
+            if fps > best[0]:
+                best = (fps, best[1], best[2], num_streams, best[4])
+
+    fps, name, fp16, num_streams, tile = best
+    logger.info(f"autotune: using {name} fp16={fp16} num_streams={num_streams} tilesize={tile}")
+
+    cache[key] = {
+        "backend": name,
+        "fp16": fp16,
+        "num_streams": num_streams,
+        "tilesize": list(tile),
+        "fps": fps
+    }
+
+    try:
+        os.makedirs(os.path.dirname(cache_path), exist_ok=True)
+        with open(cache_path, "w") as file:
+            json.dump(cache, file, indent=2)
+    except OSError as e:
+        logger.warning(f"autotune: {cache_path} not writable: {e}")
+
+    return configure(name, fp16, num_streams, tile)
+
+
 def inference(
     clips: typing.List[vs.VideoNode],
     network_path: typing.Union[bytes, str],
     overlap: typing.Tuple[int, int],
     tilesize: typing.Tuple[int, int],
     backend: backendT,
-    path_is_serialization: bool = False
+    path_is_serialization: bool = False,
+    scalars: typing.Optional[typing.List[float]] = None,
+    prescale: int = 1
 ) -> vs.VideoNode:
 
+    if isinstance(backend, Backend.AUTO):
+        backend, tilesize = autotune(
+            clips=clips, network_path=network_path,
+            overlap=overlap, tilesize=tilesize,
+            backend=backend,
+            path_is_serialization=path_is_serialization,
+            scalars=scalars, prescale=prescale
+        )
+
     if not path_is_serialization:
         network_path = typing.cast(str, network_path)
         if not os.path.exists(network_path):
@@ -869,20 +1199,68 @@ def inference(
                 f'built-in models can be found at https://github.com/AmusementClub/vs-mlrt/releases'
             )
 
+    # input channels of a single value, materialized as planes for
+    # backends that do not fill them into the input tensor
+    if scalars and isinstance(backend, Backend.TRT):
+        clips = clips + [
+            core.std.BlankClip(clips[0], format=vs.GRAYS, color=scalar)
+            for scalar in scalars
+        ]
+        scalars = None
+
+    if prescale > 1 and isinstance(backend, Backend.TRT):
+        # emulating cv2.resize(interpolation=cv2.INTER_CUBIC)
+        clips = [
+            core.resize.Bicubic(
+                clip,
+                clip.width * prescale, clip.height * prescale,
+                filter_param_a=0, filter_param_b=0.75
+            )
+            for clip in clips
+        ]
+        prescale = 1
+
     if isinstance(backend, Backend.ORT_CPU):
         clip = core.ort.Model(
             clips, network_path,
-            overlap=overlap, tilesize=tilesize,
+            overlap=None if backend.auto_overlap else overlap,
+            auto_overlap=backend.auto_overlap,
+            tilesize=tilesize,
             provider="CPU", builtin=False,
             num_streams=backend.num_streams,
             verbosity=backend.verbosity,
             fp16=backend.fp16,
-            path_is_serialization=path_is_serialization
+            path_is_serialization=path_is_serialization,
+            batch=backend.batch,
+            edge_alignment=backend.edge_alignment,
+            padding=backend.padding,
+            blend=backend.blend,
+            dynamic_batch=backend.dynamic_batch,
+            batch_timeout=backend.batch_timeout,
+            latency_mode=backend.latency_mode,
+            pipeline=backend.pipeline,
+            dedup=backend.dedup,
+            dedup_threshold=backend.dedup_threshold,
+            tile_cache=backend.tile_cache,
+            tile_cache_threshold=backend.tile_cache_threshold,
+            constant_cache=backend.constant_cache,
+            roi=backend.roi,
+            mask=backend.mask,
+            scalars=scalars,
+            prescale=prescale,
+            shared_session=backend.shared_session,
+            global_threads=backend.global_threads,
+            global_spin=backend.global_spin,
+            global_affinity=backend.global_affinity,
+            model_cache=backend.model_cache,
+            fp16_io=backend.fp16_io
         )
     elif isinstance(backend, Backend.ORT_CUDA):
         clip = core.ort.Model(
             clips, network_path,
-            overlap=overlap, tilesize=tilesize,
+            overlap=None if backend.auto_overlap else overlap,
+            auto_overlap=backend.auto_overlap,
+            tilesize=tilesize,
             provider="CUDA", builtin=False,
             device_id=backend.device_id,
             num_streams=backend.num_streams,
@@ -890,7 +1268,29 @@ def inference(
             cudnn_benchmark=backend.cudnn_benchmark,
             fp16=backend.fp16,
             path_is_serialization=path_is_serialization,
-            use_cuda_graph=backend.use_cuda_graph
+            use_cuda_graph=backend.use_cuda_graph,
+            batch=backend.batch,
+            edge_alignment=backend.edge_alignment,
+            padding=backend.padding,
+            blend=backend.blend,
+            dynamic_batch=backend.dynamic_batch,
+            batch_timeout=backend.batch_timeout,
+            latency_mode=backend.latency_mode,
+            dedup=backend.dedup,
+            dedup_threshold=backend.dedup_threshold,
+            tile_cache=backend.tile_cache,
+            tile_cache_threshold=backend.tile_cache_threshold,
+            constant_cache=backend.constant_cache,
+            roi=backend.roi,
+            mask=backend.mask,
+            scalars=scalars,
+            prescale=prescale,
+            shared_session=backend.shared_session,
+            global_threads=backend.global_threads,
+            global_spin=backend.global_spin,
+            global_affinity=backend.global_affinity,
+            model_cache=backend.model_cache,
+            fp16_io=backend.fp16_io
         )
     elif isinstance(backend, Backend.OV_CPU):
         config = lambda: dict(
@@ -899,11 +1299,29 @@ def inference(
         )
         clip = core.ov.Model(
             clips, network_path,
-            overlap=overlap, tilesize=tilesize,
+            overlap=None if backend.auto_overlap else overlap,
+            auto_overlap=backend.auto_overlap,
+            tilesize=tilesize,
             device="CPU", builtin=False,
             fp16=backend.fp16,
             config=config,
-            path_is_serialization=path_is_serialization
+            path_is_serialization=path_is_serialization,
+            batch=backend.batch,
+            edge_alignment=backend.edge_alignment,
+            padding=backend.padding,
+            blend=backend.blend,
+            pipeline=backend.pipeline,
+            dedup=backend.dedup,
+            dedup_threshold=backend.dedup_threshold,
+            tile_cache=backend.tile_cache,
+            tile_cache_threshold=backend.tile_cache_threshold,
+            constant_cache=backend.constant_cache,
+            roi=backend.roi,
+            mask=backend.mask,
+            scalars=scalars,
+            prescale=prescale,
+            model_cache=backend.model_cache,
+            fp16_io=backend.fp16_io
         )
     elif isinstance(backend, Backend.OV_GPU):
         config = lambda: dict(
@@ -911,11 +1329,29 @@ def inference(
         )
         clip = core.ov.Model(
             clips, network_path,
-            overlap=overlap, tilesize=tilesize,
+            overlap=None if backend.auto_overlap else overlap,
+            auto_overlap=backend.auto_overlap,
+            tilesize=tilesize,
             device=f"GPU.{backend.device_id}", builtin=False,
             fp16=backend.fp16,
             config=config,
-            path_is_serialization=path_is_serialization
+            path_is_serialization=path_is_serialization,
+            batch=backend.batch,
+            edge_alignment=backend.edge_alignment,
+            padding=backend.padding,
+            blend=backend.blend,
+            pipeline=backend.pipeline,
+            dedup=backend.dedup,
+            dedup_threshold=backend.dedup_threshold,
+            tile_cache=backend.tile_cache,
+            tile_cache_threshold=backend.tile_cache_threshold,
+            constant_cache=backend.constant_cache,
+            roi=backend.roi,
+            mask=backend.mask,
+            scalars=scalars,
+            prescale=prescale,
+            model_cache=backend.model_cache,
+            fp16_io=backend.fp16_io
         )
     elif isinstance(backend, Backend.TRT):
         if path_is_serialization:
@@ -944,6 +1380,8 @@ def inference(
             clips, engine_path,
             overlap=overlap,
             tilesize=tilesize,
+            padding=backend.padding,
+            blend=backend.blend,
             device_id=backend.device_id,
             use_cuda_graph=backend.use_cuda_graph,
             num_streams=backend.num_streams,
@@ -961,7 +1399,9 @@ def inference_with_fallback(
     overlap: typing.Tuple[int, int],
     tilesize: typing.Tuple[int, int],
     backend: backendT,
-    path_is_serialization: bool = False
+    path_is_serialization: bool = False,
+    scalars: typing.Optional[typing.List[float]] = None,
+    prescale: int = 1
 ) -> vs.VideoNode:
 
     try:
@@ -969,7 +1409,8 @@ def inference_with_fallback(
             clips=clips, network_path=network_path,
             overlap=overlap, tilesize=tilesize,
             backend=backend,
-            path_is_serialization=path_is_serialization
+            path_is_serialization=path_is_serialization,
+            scalars=scalars, prescale=prescale
         )
     except Exception as e:
         if fallback_backend is not None:
@@ -981,7 +1422,8 @@ def inference_with_fallback(
                 clips=clips, network_path=network_path,
                 overlap=overlap, tilesize=tilesize,
                 backend=fallback_backend,
-                path_is_serialization=path_is_serialization
+                path_is_serialization=path_is_serialization,
+                scalars=scalars, prescale=prescale
             )
         else:
             raise e
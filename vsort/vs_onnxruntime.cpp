@@ -1,19 +1,26 @@
 #include <array>
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <ios>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <variant>
 #include <vector>
 
 #if not __cpp_lib_atomic_wait
 #include <chrono>
-#include <thread>
 using namespace std::chrono_literals;
 #endif
 
@@ -29,21 +36,55 @@ using namespace std::chrono_literals;
 #include <cuda_runtime.h>
 #endif // ENABLE_CUDA
 
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif // _MSC_VER
+
 #include "config.h"
+#include "../common/dynamic_batcher.h"
+#include "../common/constant_tile_cache.h"
+#include "../common/frame_deduplicator.h"
+#include "../common/onnx_cache.h"
+#include "../common/roi.h"
+#include "../common/sha256.h"
+#include "../common/tile_cache.h"
+#include "../common/tiling.h"
 
 
 extern std::variant<std::string, ONNX_NAMESPACE::ModelProto> loadONNX(
     const std::string_view & path,
     int64_t tile_w,
     int64_t tile_h,
+    int64_t batch,
     bool path_is_serialization
 ) noexcept;
 
+extern std::variant<std::string, std::array<int, 2>> receptiveFieldOverlap(
+    const ONNX_NAMESPACE::ModelProto & model
+) noexcept;
+
 extern void convert_float_to_float16(
     ONNX_NAMESPACE::ModelProto & model,
-    bool force_fp16_initializers
+    bool force_fp16_initializers,
+    bool keep_io_types
 ) noexcept;
 
+// resident memory of the process in bytes, 0 if unknown
+#ifdef _MSC_VER
+extern size_t residentMemory() noexcept; // win32.cpp
+#else
+size_t residentMemory() noexcept {
+    std::ifstream statm { "/proc/self/statm" };
+
+    size_t size, resident;
+    if (!(statm >> size >> resident)) {
+        return 0;
+    }
+
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+#endif // _MSC_VER
+
 
 #ifdef ENABLE_COREML
 extern "C" OrtStatusPtr OrtSessionOptionsAppendExecutionProvider_CoreML(OrtSessionOptions *so, int flags);
@@ -91,6 +132,125 @@ static std::optional<std::string> ortInit() noexcept {
 }
 
 
+// configuration of the global thread pools of the environment
+struct ThreadPoolConfig {
+    int threads; // 0: one per physical core
+    bool spin;
+    std::string affinity; // empty: default
+};
+
+// ORT has a single environment per process, which is shared by all filters
+// and released with the last of them. Its global thread pools are created
+// with it, so all filters that run on them must agree on their configuration.
+struct Environment {
+    OrtEnv * env {};
+
+    // engaged if the environment has global thread pools
+    std::optional<ThreadPoolConfig> thread_pool;
+
+    ~Environment() {
+        if (env) {
+            ortapi->ReleaseEnv(env);
+        }
+    }
+};
+
+static std::mutex environment_lock;
+static std::weak_ptr<Environment> shared_environment;
+
+[[nodiscard]]
+static std::variant<std::string, std::shared_ptr<Environment>> getEnvironment(
+    OrtLoggingLevel verbosity,
+    const std::optional<ThreadPoolConfig> & thread_pool
+) noexcept {
+
+    const auto set_error = [](const std::string & error_message) {
+        return error_message;
+    };
+
+    std::lock_guard lock { environment_lock };
+
+    if (auto environment = shared_environment.lock(); environment) {
+        if (thread_pool.has_value()) {
+            if (!environment->thread_pool.has_value()) {
+                return set_error("the global thread pool must be enabled by the first filter");
+            }
+
+            const auto & config = environment->thread_pool.value();
+            if (config.threads != thread_pool->threads || config.spin != thread_pool->spin ||
+                config.affinity != thread_pool->affinity
+            ) {
+                return set_error("the global thread pool is configured differently by an earlier filter");
+            }
+        }
+
+        return environment;
+    }
+
+    auto environment = std::make_shared<Environment>();
+    auto logger_id_str = "vs-ort" + std::to_string(logger_id.fetch_add(1, std::memory_order::relaxed));
+
+    if (thread_pool.has_value()) {
+        OrtThreadingOptions * threading_options;
+        checkError(ortapi->CreateThreadingOptions(&threading_options));
+        std::unique_ptr<OrtThreadingOptions, decltype(ortapi->ReleaseThreadingOptions)> guard {
+            threading_options, ortapi->ReleaseThreadingOptions
+        };
+
+        // sessions run sequentially
+        checkError(ortapi->SetGlobalIntraOpNumThreads(threading_options, thread_pool->threads));
+        checkError(ortapi->SetGlobalInterOpNumThreads(threading_options, 1));
+        checkError(ortapi->SetGlobalSpinControl(threading_options, thread_pool->spin));
+        if (!std::empty(thread_pool->affinity)) {
+            checkError(ortapi->SetGlobalIntraOpThreadAffinity(
+                threading_options, thread_pool->affinity.c_str()
+            ));
+        }
+
+        checkError(ortapi->CreateEnvWithGlobalThreadPools(
+            verbosity, logger_id_str.c_str(), threading_options, &environment->env
+        ));
+    } else {
+        checkError(ortapi->CreateEnv(verbosity, logger_id_str.c_str(), &environment->env));
+    }
+
+    environment->thread_pool = thread_pool;
+    shared_environment = environment;
+
+    return environment;
+}
+
+
+// the prepacked weights of the CPU kernels, shared by the sessions of all
+// filters and released with the last of them, ORT keys them by the content
+// of the weights, so repeated models are prepacked once per process
+static std::mutex prepacked_weights_lock;
+static std::weak_ptr<OrtPrepackedWeightsContainer> prepacked_weights;
+
+[[nodiscard]]
+static std::variant<std::string, std::shared_ptr<OrtPrepackedWeightsContainer>> getPrepackedWeights() noexcept {
+    const auto set_error = [](const std::string & error_message) {
+        return error_message;
+    };
+
+    std::lock_guard lock { prepacked_weights_lock };
+
+    if (auto container = prepacked_weights.lock(); container) {
+        return container;
+    }
+
+    OrtPrepackedWeightsContainer * container;
+    checkError(ortapi->CreatePrepackedWeightsContainer(&container));
+
+    std::shared_ptr<OrtPrepackedWeightsContainer> shared {
+        container, ortapi->ReleasePrepackedWeightsContainer
+    };
+    prepacked_weights = shared;
+
+    return shared;
+}
+
+
 [[nodiscard]]
 static std::variant<std::string, std::array<int64_t, 4>> getShape(
     const OrtTensorTypeAndShapeInfo* tensor_info
@@ -152,14 +312,83 @@ static int numPlanes(
 }
 
 
+[[nodiscard]]
+static std::optional<std::string> parseScalars(
+    const VSMap * in,
+    std::vector<float> & scalars,
+    std::vector<std::string> & scalar_props,
+    const VSAPI * vsapi
+) noexcept {
+
+    int num_scalars = vsapi->propNumElements(in, "scalars");
+    for (int i = 0; i < num_scalars; ++i) {
+        scalars.push_back(static_cast<float>(vsapi->propGetFloat(in, "scalars", i, nullptr)));
+    }
+
+    int num_props = vsapi->propNumElements(in, "scalar_props");
+    if (num_props == -1) {
+        return {};
+    }
+    if (num_props != static_cast<int>(std::size(scalars))) {
+        return "\"scalar_props\" must have as many elements as \"scalars\"";
+    }
+
+    bool named = false;
+    for (int i = 0; i < num_props; ++i) {
+        scalar_props.emplace_back(vsapi->propGetData(in, "scalar_props", i, nullptr));
+        named = named || !std::empty(scalar_props.back());
+    }
+
+    // constant channels only
+    if (!named) {
+        scalar_props.clear();
+    }
+
+    return {};
+}
+
+
+// keeps `value` if the frame has no such numeric property
+static void readScalarProp(
+    const VSMap * props,
+    const std::string & name,
+    float & value,
+    const VSAPI * vsapi
+) noexcept {
+
+    if (std::empty(name)) {
+        return;
+    }
+
+    int error;
+    double prop = vsapi->propGetFloat(props, name.c_str(), 0, &error);
+    if (error) {
+        prop = static_cast<double>(vsapi->propGetInt(props, name.c_str(), 0, &error));
+    }
+    if (!error) {
+        value = static_cast<float>(prop);
+    }
+}
+
+
 [[nodiscard]]
 static std::optional<std::string> checkNodes(
     const std::vector<const VSVideoInfo *> & vis
 ) noexcept {
 
     for (const auto & vi : vis) {
-        if (vi->format->sampleType != stFloat || vi->format->bitsPerSample != 32) {
-            return "expects clip with type fp32";
+        bool is_float = vi->format->sampleType == stFloat && (
+            vi->format->bitsPerSample == 32 || vi->format->bitsPerSample == 16
+        );
+        bool is_integer = vi->format->sampleType == stInteger && vi->format->bitsPerSample <= 16;
+        if (!is_float && !is_integer) {
+            return "expects clip with type fp16, fp32 or 8-16 bit integer";
+        }
+
+        if (vi->format->sampleType != vis[0]->format->sampleType ||
+            vi->format->bitsPerSample != vis[0]->format->bitsPerSample
+        ) {
+            return "sample types of clips mismatch";
         }
 
         if (vi->width != vis[0]->width || vi->height != vis[0]->height) {
@@ -182,7 +411,9 @@ static std::optional<std::string> checkNodes(
 [[nodiscard]]
 static std::optional<std::string> checkIOInfo(
     const OrtTypeInfo * info,
-    bool is_output
+    bool is_output,
+    int batch,
+    ONNXTensorElementDataType tensor_type
 ) noexcept {
 
     const auto set_error = [](const std::string & error_message) {
@@ -195,8 +426,12 @@ static std::optional<std::string> checkIOInfo(
     ONNXTensorElementDataType element_type;
     checkError(ortapi->GetTensorElementType(tensor_info, &element_type));
 
-    if (element_type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
-        return set_error("expects network IO with type fp32");
+    if (element_type != tensor_type) {
+        if (tensor_type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16) {
+            return set_error("expects network IO with type fp16");
+        } else {
+            return set_error("expects network IO with type fp32");
+        }
     }
 
     size_t num_dims;
@@ -211,8 +446,8 @@ static std::optional<std::string> checkIOInfo(
     }
 
     auto shape = std::get<std::array<int64_t, 4>>(maybe_shape);
-    if (shape[0] != 1) {
-        return set_error("batch size of network must be 1");
+    if (shape[0] != batch) {
+        return set_error("batch size of network must be " + std::to_string(batch));
     }
 
     if (is_output) {
@@ -228,7 +463,9 @@ static std::optional<std::string> checkIOInfo(
 
 [[nodiscard]]
 static std::optional<std::string> checkSession(
-    const OrtSession * session
+    const OrtSession * session,
+    int batch,
+    ONNXTensorElementDataType tensor_type
 ) noexcept {
 
     const auto set_error = [](const std::string & error_message) {
@@ -245,7 +482,7 @@ static std::optional<std::string> checkSession(
     OrtTypeInfo * input_type_info;
     checkError(ortapi->SessionGetInputTypeInfo(session, 0, &input_type_info));
 
-    if (auto err = checkIOInfo(input_type_info, false); err.has_value()) {
+    if (auto err = checkIOInfo(input_type_info, false, batch, tensor_type); err.has_value()) {
         return set_error(err.value());
     }
 
@@ -261,7 +498,7 @@ static std::optional<std::string> checkSession(
     OrtTypeInfo * output_type_info;
     checkError(ortapi->SessionGetOutputTypeInfo(session, 0, &output_type_info));
 
-    if (auto err = checkIOInfo(output_type_info, true); err.has_value()) {
+    if (auto err = checkIOInfo(output_type_info, true, batch, tensor_type); err.has_value()) {
         return set_error(err.value());
     }
 
@@ -273,7 +510,9 @@ static std::optional<std::string> checkSession(
 [[nodiscard]]
 static std::optional<std::string> checkNodesAndNetwork(
     const OrtSession * session,
-    const std::vector<const VSVideoInfo *> & vis
+    const std::vector<const VSVideoInfo *> & vis,
+    int num_scalars,
+    bool padding
 ) noexcept {
 
     const auto set_error = [](const std::string & error_message) {
@@ -290,15 +529,15 @@ static std::optional<std::string> checkNodesAndNetwork(
 
     int network_in_channels = static_cast<int>(network_in_dims[1]);
     int num_planes = numPlanes(vis);
-    if (network_in_channels != num_planes) {
-        return set_error("expects " + std::to_string(network_in_channels) + " input planes");
+    if (network_in_channels != num_planes + num_scalars) {
+        return set_error("expects " + std::to_string(network_in_channels - num_scalars) + " input planes");
     }
 
     auto network_in_height = network_in_dims[2];
     auto network_in_width = network_in_dims[3];
     auto clip_in_height = vis.front()->height;
     auto clip_in_width = vis.front()->width;
-    if (network_in_height > clip_in_height || network_in_width > clip_in_width) {
+    if (!padding && (network_in_height > clip_in_height || network_in_width > clip_in_width)) {
         return set_error("tile size larger than clip dimension");
     }
 
@@ -344,6 +583,21 @@ struct TicketSemaphore {
         }
     }
 
+    // succeeds only if a slot is free and no one is waiting for one
+    bool try_acquire() noexcept {
+        intptr_t tk { ticket.load(std::memory_order_acquire) };
+        while (tk <= current.load(std::memory_order_acquire)) {
+            if (ticket.compare_exchange_weak(tk, tk + 1, std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool contended() const noexcept {
+        return ticket.load(std::memory_order_relaxed) > current.load(std::memory_order_relaxed) + 1;
+    }
+
     void release() noexcept {
         current.fetch_add(1, std::memory_order_release);
 #if __cpp_lib_atomic_wait
@@ -352,6 +606,57 @@ struct TicketSemaphore {
     }
 };
 
+// a long-lived thread of a stream that runs the submitted tasks in order
+struct StreamWorker {
+    StreamWorker() noexcept : thread { [this] { loop(); } } {}
+
+    ~StreamWorker() {
+        {
+            std::lock_guard lock { mutex };
+            stop = true;
+        }
+        cv.notify_one();
+        thread.join();
+    }
+
+    std::future<void> submit(std::function<void()> task) noexcept {
+        std::packaged_task<void()> packaged_task { std::move(task) };
+        auto future = packaged_task.get_future();
+        {
+            std::lock_guard lock { mutex };
+            tasks.push_back(std::move(packaged_task));
+        }
+        cv.notify_one();
+        return future;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::packaged_task<void()>> tasks;
+    bool stop {};
+
+    // started after the other members are initialized
+    std::thread thread;
+
+    void loop() noexcept {
+        std::unique_lock lock { mutex };
+        while (true) {
+            cv.wait(lock, [this] { return stop || !std::empty(tasks); });
+            if (std::empty(tasks)) {
+                return;
+            }
+
+            auto task = std::move(tasks.front());
+            tasks.pop_front();
+
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+};
+
 enum class Backend {
     CPU = 0,
     CUDA = 1,
@@ -369,10 +674,20 @@ struct CUDA_Resource_t {
 // per-stream context
 struct Resource {
     OrtSession * session;
+
+    // false if the session is shared with the first stream
+    bool owns_session;
+
     OrtValue * input_tensor;
     OrtValue * output_tensor;
     OrtIoBinding * binding;
 
+    // second set of tensors for overlapping copies with inference,
+    // null if not pipelined
+    OrtValue * back_input_tensor;
+    OrtValue * back_output_tensor;
+    OrtIoBinding * back_binding;
+
 #ifdef ENABLE_CUDA
     cudaStream_t stream;
     CUDA_Resource_t input;
@@ -385,18 +700,64 @@ struct vsOrtData {
     std::vector<VSNodeRef *> nodes;
     std::unique_ptr<VSVideoInfo> out_vi;
 
-    int overlap_w, overlap_h;
+    TilePlan plan;
 
-    OrtEnv * environment;
+    std::shared_ptr<Environment> environment;
     Backend backend;
 
+    // outlives the sessions, null unless on CPU
+    std::shared_ptr<OrtPrepackedWeightsContainer> prepacked_weights;
+
     int device_id;
 
+    // the resources of all tile shapes of a stream are adjacent
     std::vector<Resource> resources;
     std::vector<int> tickets;
     std::mutex ticket_lock;
     TicketSemaphore semaphore;
 
+    // cross-frame tile batching, disabled if null
+    std::unique_ptr<DynamicBatcher> batcher;
+
+    // reuses the output of duplicate frames, disabled if null
+    std::unique_ptr<FrameDeduplicator> deduplicator;
+
+    // reuses the output of unchanged tiles, disabled if null
+    std::unique_ptr<TileCache> tile_cache;
+
+    // reuses the output of constant tiles, disabled if null
+    std::unique_ptr<ConstantTileCache> constant_cache;
+
+    // infers the tiles of a rectangle or of a mask only, disabled if null
+    std::unique_ptr<RegionOfInterest> roi;
+    VSNodeRef * mask_node {};
+
+    // values of the input channels that follow the planes of the clips,
+    // read from the frame property of the first clip if it is named
+    std::vector<float> scalars;
+    std::vector<std::string> scalar_props;
+    ScalarChannelCache scalar_cache;
+
+    // spreads the tiles of a frame over idle streams
+    bool latency_mode;
+
+    // per stream, runs the batches of extra streams in latency mode and
+    // the copies of pipelined streams, empty unless one of them is enabled
+    std::vector<std::unique_ptr<StreamWorker>> workers;
+
+    // double-buffers the tensors of each stream
+    bool pipeline;
+
+    std::string input_name;
+    std::string output_name;
+
+    // element type of the network IO, fp32 or fp16
+    ONNXTensorElementDataType tensor_type;
+
+    Resource & resource(int ticket, int shape) noexcept {
+        return resources[ticket * std::size(plan.shapes) + shape];
+    }
+
     int acquire() noexcept {
         semaphore.acquire();
         {
@@ -407,6 +768,18 @@ struct vsOrtData {
         }
     }
 
+    std::optional<int> try_acquire() noexcept {
+        if (!semaphore.try_acquire()) {
+            return {};
+        }
+        {
+            std::lock_guard<std::mutex> lock(ticket_lock);
+            int ticket = tickets.back();
+            tickets.pop_back();
+            return ticket;
+        }
+    }
+
     void release(int ticket) noexcept {
         {
             std::lock_guard<std::mutex> lock(ticket_lock);
@@ -431,247 +804,571 @@ static void VS_CC vsOrtInit(
 }
 
 
-static const VSFrameRef *VS_CC vsOrtGetFrame(
-    int n,
-    int activationReason,
-    void **instanceData,
-    void **frameData,
-    VSFrameContext *frameCtx,
-    VSCore *core,
-    const VSAPI *vsapi
+// packs up to `plan.batch` tiles into the input tensor of a stream,
+// runs the session and unpacks the output
+[[nodiscard]]
+static std::optional<std::string> inferTiles(
+    vsOrtData * d,
+    Resource & resource,
+    const TileJob * jobs,
+    int count
 ) noexcept {
 
-    auto d = static_cast<vsOrtData *>(*instanceData);
-
-    if (activationReason == arInitial) {
-        for (const auto & node : d->nodes) {
-            vsapi->requestFrameFilter(n, node, frameCtx);
-        }
-    } else if (activationReason == arAllFramesReady) {
-        std::vector<const VSVideoInfo *> in_vis;
-        in_vis.reserve(std::size(d->nodes));
-        for (const auto & node : d->nodes) {
-            in_vis.emplace_back(vsapi->getVideoInfo(node));
-        }
+    const auto set_error = [](const std::string & error_message) {
+        return error_message;
+    };
 
-        std::vector<const VSFrameRef *> src_frames;
-        src_frames.reserve(std::size(d->nodes));
-        for (const auto & node : d->nodes) {
-            src_frames.emplace_back(vsapi->getFrameFilter(n, node, frameCtx));
-        }
+    uint8_t * input_buffer;
+    uint8_t * output_buffer;
+#ifdef ENABLE_CUDA
+    if (d->backend == Backend::CUDA) {
+        input_buffer = resource.input.h_data;
+        output_buffer = resource.output.h_data;
+    } else
+#endif // ENABLE_CUDA
+    {
+        checkError(ortapi->GetTensorMutableData(
+            resource.input_tensor,
+            reinterpret_cast<void **>(&input_buffer)
+        ));
+        checkError(ortapi->GetTensorMutableData(
+            resource.output_tensor,
+            reinterpret_cast<void **>(&output_buffer)
+        ));
+    }
 
-        auto src_stride = vsapi->getStride(src_frames.front(), 0);
-        auto src_width = vsapi->getFrameWidth(src_frames.front(), 0);
-        auto src_height = vsapi->getFrameHeight(src_frames.front(), 0);
-        auto src_bytes = vsapi->getFrameFormat(src_frames.front())->bytesPerSample;
+    packBatch(d->plan, jobs, count, input_buffer);
 
-        VSFrameRef * const dst_frame = vsapi->newVideoFrame(
-            d->out_vi->format, d->out_vi->width, d->out_vi->height,
-            src_frames.front(), core
-        );
-        auto dst_stride = vsapi->getStride(dst_frame, 0);
-        auto dst_bytes = vsapi->getFrameFormat(dst_frame)->bytesPerSample;
+#ifdef ENABLE_CUDA
+    if (d->backend == Backend::CUDA) {
+        checkCUDAError(cudaMemcpyAsync(
+            resource.input.d_data,
+            resource.input.h_data,
+            resource.input.size,
+            cudaMemcpyHostToDevice,
+            resource.stream
+        ));
 
-        auto ticket = d->acquire();
-        Resource & resource = d->resources[ticket];
+        // OrtCUDAProviderOptionsV2 disallows using custom user stream
+        // and the inference is executed on a private non-blocking stream
+        checkCUDAError(cudaStreamSynchronize(resource.stream));
 
-        auto src_tile_shape = std::get<std::array<int64_t, 4>>(getShape(resource.session, true));
-        auto src_tile_h = src_tile_shape[2];
-        auto src_tile_w = src_tile_shape[3];
-        auto src_tile_w_bytes = src_tile_w * src_bytes;
-        auto src_tile_bytes = src_tile_h * src_tile_w_bytes;
+        if (resource.require_replay) [[unlikely]] {
+            resource.require_replay = false;
 
-        std::vector<const uint8_t *> src_ptrs;
-        src_ptrs.reserve(src_tile_shape[1]);
-        for (unsigned i = 0; i < std::size(d->nodes); ++i) {
-            for (int j = 0; j < in_vis[i]->format->numPlanes; ++j) {
-                src_ptrs.emplace_back(vsapi->getReadPtr(src_frames[i], j));
-            }
+            std::lock_guard _ { capture_lock };
+            checkError(ortapi->RunWithBinding(resource.session, nullptr, resource.binding));
         }
+    }
+#endif // ENABLE_CUDA
 
-        auto step_w = src_tile_w - 2 * d->overlap_w;
-        auto step_h = src_tile_h - 2 * d->overlap_h;
+    checkError(ortapi->RunWithBinding(resource.session, nullptr, resource.binding));
 
-        auto dst_tile_shape = std::get<std::array<int64_t, 4>>(getShape(resource.session, false));
-        auto dst_tile_h = dst_tile_shape[2];
-        auto dst_tile_w = dst_tile_shape[3];
-        auto dst_tile_w_bytes = dst_tile_w * dst_bytes;
-        auto dst_tile_bytes = dst_tile_h * dst_tile_w_bytes;
-        auto dst_planes = dst_tile_shape[1];
-        uint8_t * dst_ptrs[3] {};
-        for (int i = 0; i < dst_planes; ++i) {
-            dst_ptrs[i] = vsapi->getWritePtr(dst_frame, i);
-        }
+#ifdef ENABLE_CUDA
+    if (d->backend == Backend::CUDA) {
+        checkCUDAError(cudaMemcpyAsync(
+            resource.output.h_data,
+            resource.output.d_data,
+            resource.output.size,
+            cudaMemcpyDeviceToHost,
+            resource.stream
+        ));
+        checkCUDAError(cudaStreamSynchronize(resource.stream));
+    }
+#endif // ENABLE_CUDA
 
-        auto h_scale = dst_tile_h / src_tile_h;
-        auto w_scale = dst_tile_w / src_tile_w;
+    unpackBatch(d->plan, jobs, count, output_buffer);
 
-        const auto set_error = [&](const std::string & error_message) {
-            vsapi->setFilterError(
-                (__func__ + ": "s + error_message).c_str(),
-                frameCtx
-            );
+    return {};
+}
 
-            d->release(ticket);
 
-            vsapi->freeFrame(dst_frame);
+// infers a frame that is covered by a single tile, dense planes of the frame
+// are bound to the session directly instead of being copied
+[[nodiscard]]
+static std::optional<std::string> inferFrameZeroCopy(
+    vsOrtData * d,
+    Resource & resource,
+    const TileJob & job,
+    bool bind_src,
+    bool bind_dst
+) noexcept {
 
-            for (const auto & frame : src_frames) {
-                vsapi->freeFrame(frame);
-            }
+    const auto set_error = [](const std::string & error_message) {
+        return error_message;
+    };
 
-            return nullptr;
-        };
+    const auto & plan = d->plan;
 
-#ifdef ENABLE_CUDA
-        if (d->backend == Backend::CUDA) {
-            checkCUDAError(cudaSetDevice(d->device_id));
+    OrtMemoryInfo * memory_info;
+    checkError(ortapi->CreateCpuMemoryInfo(
+        OrtDeviceAllocator, OrtMemTypeDefault, &memory_info
+    ));
+
+    OrtValue * src_tensor {};
+    OrtValue * dst_tensor {};
+
+    // restores the stream's own tensors on every exit path
+    const auto rebind = [&](std::optional<std::string> error) {
+        if (src_tensor) {
+            if (auto err = ortapi->BindInput(resource.binding, d->input_name.c_str(), resource.input_tensor); err) {
+                error = error.value_or(ortapi->GetErrorMessage(err));
+                ortapi->ReleaseStatus(err);
+            }
+            ortapi->ReleaseValue(src_tensor);
         }
-#endif // ENABLE_CUDA
-
-        int y = 0;
-        while (true) {
-            int y_crop_start = (y == 0) ? 0 : d->overlap_h;
-            int y_crop_end = (y == src_height - src_tile_h) ? 0 : d->overlap_h;
+        if (dst_tensor) {
+            if (auto err = ortapi->BindOutput(resource.binding, d->output_name.c_str(), resource.output_tensor); err) {
+                error = error.value_or(ortapi->GetErrorMessage(err));
+                ortapi->ReleaseStatus(err);
+            }
+            ortapi->ReleaseValue(dst_tensor);
+        }
+        ortapi->ReleaseMemoryInfo(memory_info);
+        return error;
+    };
 
-            int x = 0;
-            while (true) {
-                int x_crop_start = (x == 0) ? 0 : d->overlap_w;
-                int x_crop_end = (x == src_width - src_tile_w) ? 0 : d->overlap_w;
+    const auto run = [&]() -> std::optional<std::string> {
+        if (bind_src) {
+            const std::array<int64_t, 4> shape { 1, plan.src_planes, plan.tile_h, plan.tile_w };
+            checkError(ortapi->CreateTensorWithDataAsOrtValue(
+                memory_info,
+                const_cast<uint8_t *>(job.io->src_ptrs[0]), plan.src_tile_bytes,
+                std::data(shape), std::size(shape),
+                d->tensor_type, &src_tensor
+            ));
+            checkError(ortapi->BindInput(resource.binding, d->input_name.c_str(), src_tensor));
+        } else {
+            uint8_t * input_buffer;
+            checkError(ortapi->GetTensorMutableData(
+                resource.input_tensor,
+                reinterpret_cast<void **>(&input_buffer)
+            ));
+            packBatch(plan, &job, 1, input_buffer);
+        }
 
-                {
-                    uint8_t * input_buffer;
-#ifdef ENABLE_CUDA
-                    uint8_t * h_input_buffer = resource.input.h_data;
-#endif // ENABLE_CUDA
-                    checkError(ortapi->GetTensorMutableData(
-                        resource.input_tensor,
-                        reinterpret_cast<void **>(&input_buffer)
-                    ));
+        if (bind_dst) {
+            const std::array<int64_t, 4> shape { 1, plan.dst_planes, plan.dst_tile_h, plan.dst_tile_w };
+            checkError(ortapi->CreateTensorWithDataAsOrtValue(
+                memory_info,
+                job.io->dst_ptrs[0], plan.dst_tile_bytes,
+                std::data(shape), std::size(shape),
+                d->tensor_type, &dst_tensor
+            ));
+            checkError(ortapi->BindOutput(resource.binding, d->output_name.c_str(), dst_tensor));
+        }
 
-                    for (const auto & _src_ptr : src_ptrs) {
-                        const uint8_t * src_ptr { _src_ptr +
-                            y * src_stride + x * src_bytes
-                        };
+        checkError(ortapi->RunWithBinding(resource.session, nullptr, resource.binding));
 
+        if (!bind_dst) {
+            uint8_t * output_buffer;
+            checkError(ortapi->GetTensorMutableData(
+                resource.output_tensor,
+                reinterpret_cast<void **>(&output_buffer)
+            ));
+            unpackBatch(plan, &job, 1, output_buffer);
+        }
+
+        return {};
+    };
+
+    return rebind(run());
+}
+
+
+// runs the batches of a frame on a pipelined stream, the next batch is packed
+// and the previous one is unpacked while the current one is inferred
+[[nodiscard]]
+static std::optional<std::string> inferTilesPipelined(
+    vsOrtData * d,
+    int ticket,
+    const TileJob * jobs,
+    const std::vector<TileBatch> & batches
+) noexcept {
+
+    const auto set_error = [](const std::string & error_message) {
+        return error_message;
+    };
+
+    const int num_batches = static_cast<int>(std::size(batches));
+
+    // odd batches use the second set of tensors of the resource of their shape,
+    // so adjacent batches never share tensors
+    std::vector<OrtSession *> sessions(num_batches);
+    std::vector<OrtIoBinding *> bindings(num_batches);
+    std::vector<uint8_t *> input_buffers(num_batches);
+    std::vector<uint8_t *> output_buffers(num_batches);
+    for (int k = 0; k < num_batches; ++k) {
+        Resource & resource = d->resource(ticket, batches[k].shape);
+        bool back = k % 2;
+
+        sessions[k] = resource.session;
+        bindings[k] = back ? resource.back_binding : resource.binding;
+        checkError(ortapi->GetTensorMutableData(
+            back ? resource.back_input_tensor : resource.input_tensor,
+            reinterpret_cast<void **>(&input_buffers[k])
+        ));
+        checkError(ortapi->GetTensorMutableData(
+            back ? resource.back_output_tensor : resource.output_tensor,
+            reinterpret_cast<void **>(&output_buffers[k])
+        ));
+    }
+
+    packBatch(d->plan, &jobs[batches[0].first], batches[0].count, input_buffers[0]);
+
+    StreamWorker & copier = *d->workers[ticket];
+
+    for (int k = 0; k < num_batches; ++k) {
+        auto copies = copier.submit([&, k]() {
+            if (k > 0) {
+                const auto & batch = batches[k - 1];
+                unpackBatch(d->plan, &jobs[batch.first], batch.count, output_buffers[k - 1]);
+            }
+            if (k + 1 < num_batches) {
+                const auto & batch = batches[k + 1];
+                packBatch(d->plan, &jobs[batch.first], batch.count, input_buffers[k + 1]);
+            }
+        });
+
+        const auto run = [&]() -> std::optional<std::string> {
+            checkError(ortapi->RunWithBinding(sessions[k], nullptr, bindings[k]));
+            return {};
+        };
+        auto err = run();
+
+        // the copies use the tensors of this frame, even on failure
+        copies.wait();
+
+        if (err.has_value()) {
+            return err;
+        }
+    }
+
+    const auto & batch = batches[num_batches - 1];
+    unpackBatch(d->plan, &jobs[batch.first], batch.count, output_buffers[num_batches - 1]);
+
+    return {};
+}
+
+
+// runs the batches of a frame on the acquired stream and on every idle one,
+// extra streams are handed back once another frame is waiting for a stream
+[[nodiscard]]
+static std::optional<std::string> inferTilesParallel(
+    vsOrtData * d,
+    const TileJob * jobs,
+    const std::vector<TileBatch> & batches
+) noexcept {
+
+    const int num_batches = static_cast<int>(std::size(batches));
+
+    std::atomic<int> next_batch { 0 };
+    std::atomic<bool> failed { false };
+    std::mutex error_lock;
+    std::optional<std::string> error;
+
+    const auto set_error = [&](const std::string & error_message) {
+        std::lock_guard<std::mutex> lock(error_lock);
+        if (!error.has_value()) {
+            error = error_message;
+        }
+        failed.store(true, std::memory_order_relaxed);
+    };
+
+    const auto worker = [&](int ticket, bool is_extra) {
 #ifdef ENABLE_CUDA
-                        if (d->backend == Backend::CUDA) {
-                            vs_bitblt(
-                                h_input_buffer, src_tile_w_bytes,
-                                src_ptr, src_stride,
-                                src_tile_w_bytes, src_tile_h
-                            );
-                            h_input_buffer += src_tile_bytes;
-                        } else
+        if (is_extra && d->backend == Backend::CUDA) {
+            if (auto result = cudaSetDevice(d->device_id); result != cudaSuccess) {
+                set_error("'cudaSetDevice(d->device_id)' failed: "s + cudaGetErrorString(result));
+                d->release(ticket);
+                return;
+            }
+        }
 #endif // ENABLE_CUDA
-                        {
-                            vs_bitblt(
-                                input_buffer, src_tile_w_bytes,
-                                src_ptr, src_stride,
-                                src_tile_w_bytes, src_tile_h
-                            );
-                            input_buffer += src_tile_bytes;
-                        }
-                    }
-                }
 
-#ifdef ENABLE_CUDA
-                if (d->backend == Backend::CUDA) {
-                    checkCUDAError(cudaMemcpyAsync(
-                        resource.input.d_data,
-                        resource.input.h_data,
-                        resource.input.size,
-                        cudaMemcpyHostToDevice,
-                        resource.stream
-                    ));
+        while (!failed.load(std::memory_order_relaxed)) {
+            if (is_extra && d->semaphore.contended()) {
+                break;
+            }
 
-                    // OrtCUDAProviderOptionsV2 disallows using custom user stream
-                    // and the inference is executed on a private non-blocking stream
-                    checkCUDAError(cudaStreamSynchronize(resource.stream));
-                }
-#endif // ENABLE_CUDA
+            int i = next_batch.fetch_add(1, std::memory_order_relaxed);
+            if (i >= num_batches) {
+                break;
+            }
 
-                if (resource.require_replay) [[unlikely]] {
-                    resource.require_replay = false;
+            const auto & batch = batches[i];
+            Resource & resource = d->resource(ticket, batch.shape);
+            if (auto err = inferTiles(d, resource, &jobs[batch.first], batch.count); err.has_value()) {
+                set_error(err.value());
+            }
+        }
 
-                    std::lock_guard _ { capture_lock };
-                    checkError(ortapi->RunWithBinding(resource.session, nullptr, resource.binding));
-                }
+        d->release(ticket);
+    };
 
-                checkError(ortapi->RunWithBinding(resource.session, nullptr, resource.binding));
+    auto ticket = d->acquire();
 
-#ifdef ENABLE_CUDA
-                if (d->backend == Backend::CUDA) {
-                    checkCUDAError(cudaMemcpyAsync(
-                        resource.output.h_data,
-                        resource.output.d_data,
-                        resource.output.size,
-                        cudaMemcpyDeviceToHost,
-                        resource.stream
-                    ));
-                    checkCUDAError(cudaStreamSynchronize(resource.stream));
+    // an extra stream runs on its own worker, which it holds until it
+    // releases its ticket
+    std::vector<std::future<void>> helpers;
+    for (int i = 1; i < num_batches; ++i) {
+        auto extra_ticket = d->try_acquire();
+        if (!extra_ticket.has_value()) {
+            break;
+        }
+        helpers.push_back(d->workers[extra_ticket.value()]->submit(
+            [&worker, extra = extra_ticket.value()]() { worker(extra, true); }
+        ));
+    }
+
+    worker(ticket, false);
+
+    for (auto & helper : helpers) {
+        helper.wait();
+    }
+
+    return error;
+}
+
+
+static const VSFrameRef *VS_CC vsOrtGetFrame(
+    int n,
+    int activationReason,
+    void **instanceData,
+    void **frameData,
+    VSFrameContext *frameCtx,
+    VSCore *core,
+    const VSAPI *vsapi
+) noexcept {
+
+    auto d = static_cast<vsOrtData *>(*instanceData);
+
+    if (activationReason == arInitial) {
+        for (const auto & node : d->nodes) {
+            vsapi->requestFrameFilter(n, node, frameCtx);
+        }
+        if (d->mask_node) {
+            vsapi->requestFrameFilter(n, d->mask_node, frameCtx);
+        }
+    } else if (activationReason == arAllFramesReady) {
+        std::vector<const VSVideoInfo *> in_vis;
+        in_vis.reserve(std::size(d->nodes));
+        for (const auto & node : d->nodes) {
+            in_vis.emplace_back(vsapi->getVideoInfo(node));
+        }
+
+        std::vector<const VSFrameRef *> src_frames;
+        src_frames.reserve(std::size(d->nodes));
+        for (const auto & node : d->nodes) {
+            src_frames.emplace_back(vsapi->getFrameFilter(n, node, frameCtx));
+        }
+
+        std::shared_ptr<FrameDeduplicator::Entry> dedup_entry;
+        if (d->deduplicator) {
+            auto output = d->deduplicator->acquire(src_frames, dedup_entry, vsapi);
+            if (output) {
+                VSFrameRef * dst_frame = vsapi->copyFrame(output, core);
+                vsapi->copyFrameProps(src_frames.front(), dst_frame, core);
+                vsapi->freeFrame(output);
+
+                for (const auto & frame : src_frames) {
+                    vsapi->freeFrame(frame);
                 }
-#endif // ENABLE_CUDA
 
-                {
-                    uint8_t * output_buffer;
-#ifdef ENABLE_CUDA
-                    uint8_t * h_output_buffer = resource.output.h_data;
-#endif // ENABLE_CUDA
-                    checkError(ortapi->GetTensorMutableData(
-                        resource.output_tensor,
-                        reinterpret_cast<void **>(&output_buffer)
-                    ));
+                return dst_frame;
+            }
+        }
+
+        auto src_stride = vsapi->getStride(src_frames.front(), 0);
+
+        std::vector<const uint8_t *> src_ptrs;
+        src_ptrs.reserve(d->plan.src_planes);
+        for (unsigned i = 0; i < std::size(d->nodes); ++i) {
+            for (int j = 0; j < in_vis[i]->format->numPlanes; ++j) {
+                src_ptrs.emplace_back(vsapi->getReadPtr(src_frames[i], j));
+            }
+        }
 
-                    for (int plane = 0; plane < dst_planes; ++plane) {
-                        auto dst_ptr = (dst_ptrs[plane] +
-                            h_scale * y * dst_stride + w_scale * x * dst_bytes
-                        );
+        VSFrameRef * const dst_frame = vsapi->newVideoFrame(
+            d->out_vi->format, d->out_vi->width, d->out_vi->height,
+            src_frames.front(), core
+        );
+        auto dst_stride = vsapi->getStride(dst_frame, 0);
+
+        uint8_t * dst_ptrs[3] {};
+        for (int i = 0; i < d->plan.dst_planes; ++i) {
+            dst_ptrs[i] = vsapi->getWritePtr(dst_frame, i);
+        }
+
+        const auto set_error = [&](const std::string & error_message) {
+            vsapi->setFilterError(
+                (__func__ + ": "s + error_message).c_str(),
+                frameCtx
+            );
+
+            vsapi->freeFrame(dst_frame);
+
+            for (const auto & frame : src_frames) {
+                vsapi->freeFrame(frame);
+            }
+
+            if (dedup_entry) {
+                d->deduplicator->finish(dedup_entry, nullptr, vsapi);
+            }
+
+            return nullptr;
+        };
 
 #ifdef ENABLE_CUDA
-                        if (d->backend == Backend::CUDA) {
-                            vs_bitblt(
-                                dst_ptr + (y_crop_start * dst_stride + x_crop_start * dst_bytes),
-                                dst_stride,
-                                h_output_buffer + (y_crop_start * dst_tile_w_bytes + x_crop_start * dst_bytes),
-                                dst_tile_w_bytes,
-                                dst_tile_w_bytes - (x_crop_start + x_crop_end) * dst_bytes,
-                                dst_tile_h - (y_crop_start + y_crop_end)
-                            );
-
-                            h_output_buffer += dst_tile_bytes;
-                        } else
+        if (d->backend == Backend::CUDA) {
+            checkCUDAError(cudaSetDevice(d->device_id));
+        }
 #endif // ENABLE_CUDA
-                        {
-                            vs_bitblt(
-                                dst_ptr + (y_crop_start * dst_stride + x_crop_start * dst_bytes),
-                                dst_stride,
-                                output_buffer + (y_crop_start * dst_tile_w_bytes + x_crop_start * dst_bytes),
-                                dst_tile_w_bytes,
-                                dst_tile_w_bytes - (x_crop_start + x_crop_end) * dst_bytes,
-                                dst_tile_h - (y_crop_start + y_crop_end)
-                            );
-
-                            output_buffer += dst_tile_bytes;
-                        }
-                    }
+
+        clearBlendTarget(d->plan, dst_ptrs, dst_stride);
+
+        std::vector<float> scalars = d->scalars;
+        if (!std::empty(d->scalar_props)) {
+            const VSMap * props = vsapi->getFramePropsRO(src_frames.front());
+            for (unsigned i = 0; i < std::size(scalars); ++i) {
+                readScalarProp(props, d->scalar_props[i], scalars[i], vsapi);
+            }
+        }
+
+        std::mutex blend_mutex;
+        const FrameIO io {
+            std::data(src_ptrs), src_stride, dst_ptrs, dst_stride, &blend_mutex,
+            std::data(scalars), &d->scalar_cache
+        };
+
+        std::vector<TileJob> jobs;
+        jobs.reserve(std::size(d->plan.tiles));
+        for (const auto & tile : d->plan.tiles) {
+            jobs.push_back(TileJob { &tile, &io });
+        }
+
+        int skipped_tiles = 0;
+        if (d->roi) {
+            const VSFrameRef * mask_frame = nullptr;
+            if (d->mask_node) {
+                mask_frame = vsapi->getFrameFilter(n, d->mask_node, frameCtx);
+            }
+
+            skipped_tiles = d->roi->select(
+                d->plan, jobs,
+                mask_frame ? vsapi->getReadPtr(mask_frame, 0) : nullptr,
+                mask_frame ? vsapi->getStride(mask_frame, 0) : 0
+            );
+
+            vsapi->freeFrame(mask_frame);
+        }
+
+        std::vector<uint64_t> tile_hashes;
+        if (d->tile_cache) {
+            skipped_tiles += d->tile_cache->reuse(d->plan, jobs, tile_hashes);
+        }
+
+        ConstantTileCache::Pending constant_tiles;
+        if (d->constant_cache) {
+            skipped_tiles += d->constant_cache->reuse(d->plan, jobs, constant_tiles);
+        }
+
+        // the batches of the tiles that are left
+        const auto batches = (skipped_tiles == 0) ? d->plan.batches : makeBatches(
+            d->plan.shapes, static_cast<int>(std::size(jobs)),
+            [&jobs](int i) { return jobs[i].tile->shape; }
+        );
+
+        if (std::empty(jobs)) {
+            // every tile is reused
+        } else if (d->batcher) {
+            auto err = d->batcher->process(
+                jobs,
+                [d](const TileJob * jobs, int count) {
+                    auto ticket = d->acquire();
+                    auto err = inferTiles(d, d->resource(ticket, jobs[0].tile->shape), jobs, count);
+                    d->release(ticket);
+                    return err;
                 }
+            );
+            if (err.has_value()) {
+                return set_error(err.value());
+            }
+        } else {
+            // a single plane is a NCHW tensor on its own if its rows are dense
+            // and its samples have the element type of the tensor
+            bool single_tile = (
+                std::size(jobs) == 1 && !isPadded(d->plan, *jobs[0].tile) &&
+                !jobs[0].output_copy
+            );
+            bool bind_src = (
+                single_tile && d->backend != Backend::CUDA &&
+                d->plan.src_planes == 1 && d->plan.scalar_channels == 0 &&
+                d->plan.prescale == 1 && d->plan.src_format.is_float &&
+                d->plan.src_format.bytes == d->plan.tensor_bytes &&
+                static_cast<size_t>(src_stride) == d->plan.src_tile_w_bytes
+            );
+            bool bind_dst = (
+                single_tile && d->backend != Backend::CUDA &&
+                d->plan.dst_planes == 1 && d->plan.dst_format.is_float &&
+                d->plan.dst_format.bytes == d->plan.tensor_bytes &&
+                static_cast<size_t>(dst_stride) == d->plan.dst_tile_w_bytes
+            );
 
-                if (x + src_tile_w == src_width) {
-                    break;
+            if (bind_src || bind_dst) {
+                auto ticket = d->acquire();
+                auto err = inferFrameZeroCopy(d, d->resource(ticket, 0), jobs[0], bind_src, bind_dst);
+                d->release(ticket);
+                if (err.has_value()) {
+                    return set_error(err.value());
                 }
+            } else if (d->latency_mode) {
+                if (auto err = inferTilesParallel(d, std::data(jobs), batches); err.has_value()) {
+                    return set_error(err.value());
+                }
+            } else {
+                auto ticket = d->acquire();
 
-                x = std::min(x + step_w, src_width - src_tile_w);
-            }
+                if (d->pipeline && std::size(batches) > 1) {
+                    auto err = inferTilesPipelined(d, ticket, std::data(jobs), batches);
+                    if (err.has_value()) {
+                        d->release(ticket);
+                        return set_error(err.value());
+                    }
+                } else {
+                    for (const auto & batch : batches) {
+                        Resource & resource = d->resource(ticket, batch.shape);
+                        auto err = inferTiles(d, resource, &jobs[batch.first], batch.count);
+                        if (err.has_value()) {
+                            d->release(ticket);
+                            return set_error(err.value());
+                        }
+                    }
+                }
 
-            if (y + src_tile_h == src_height) {
-                break;
+                d->release(ticket);
             }
+        }
 
-            y = std::min(y + step_h, src_height - src_tile_h);
+        if (d->constant_cache) {
+            d->constant_cache->finish(d->plan, constant_tiles);
         }
 
-        d->release(ticket);
+        if (d->tile_cache) {
+            d->tile_cache->update(d->plan, jobs, tile_hashes);
+        }
+
+        if (d->roi || d->tile_cache || d->constant_cache) {
+            vsapi->propSetFloat(
+                vsapi->getFramePropsRW(dst_frame), "MLRTTileSkipRatio",
+                static_cast<double>(skipped_tiles) / std::size(d->plan.tiles),
+                paReplace
+            );
+        }
+
+        if (dedup_entry) {
+            d->deduplicator->finish(dedup_entry, dst_frame, vsapi);
+        }
 
         for (const auto & frame : src_frames) {
             vsapi->freeFrame(frame);
@@ -696,11 +1393,24 @@ static void VS_CC vsOrtFree(
         vsapi->freeNode(node);
     }
 
+    if (d->mask_node) {
+        vsapi->freeNode(d->mask_node);
+    }
+
+    if (d->deduplicator) {
+        d->deduplicator->clear();
+    }
+
     for (const auto & resource : d->resources) {
+        ortapi->ReleaseIoBinding(resource.back_binding);
+        ortapi->ReleaseValue(resource.back_output_tensor);
+        ortapi->ReleaseValue(resource.back_input_tensor);
         ortapi->ReleaseIoBinding(resource.binding);
         ortapi->ReleaseValue(resource.output_tensor);
         ortapi->ReleaseValue(resource.input_tensor);
-        ortapi->ReleaseSession(resource.session);
+        if (resource.owns_session) {
+            ortapi->ReleaseSession(resource.session);
+        }
 
 #ifdef ENABLE_CUDA
         if (d->backend == Backend::CUDA) {
@@ -713,12 +1423,40 @@ static void VS_CC vsOrtFree(
 #endif // ENABLE_CUDA
     }
 
-    ortapi->ReleaseEnv(d->environment);
-
     delete d;
 }
 
 
+// level of the optimizations stored in the cache
+static constexpr GraphOptimizationLevel cached_optimization_level = ORT_ENABLE_ALL;
+
+// The path of the optimized network of a serialized network in a cache
+// directory. The optimizations depend on the version of ONNX Runtime, the
+// execution provider, the optimization level and, through the layouts of
+// the CPU kernels, on the instruction set, which is approximated by the
+// kernel set of the copy kernels.
+static std::filesystem::path optimizedModelPath(
+    const std::filesystem::path & directory,
+    std::string_view onnx_data,
+    Backend backend,
+    int device_id
+) {
+
+    const char * provider = (backend == Backend::CUDA) ? "cuda" : "cpu";
+
+    const std::string options = (
+        provider + std::to_string(device_id) +
+        "_" + getCopyKernels().name +
+        "_level" + std::to_string(cached_optimization_level) +
+        "_ort" + OrtGetApiBase()->GetVersionString()
+    );
+
+    const auto digest = Sha256 {}.update(onnx_data).update(options).hexdigest();
+
+    return directory / (digest + "_" + options + ".onnx");
+}
+
+
 static void VS_CC vsOrtCreate(
     const VSMap *in,
     VSMap *out,
@@ -740,6 +1478,9 @@ static void VS_CC vsOrtCreate(
         for (const auto & node : d->nodes) {
             vsapi->freeNode(node);
         }
+        if (d->mask_node) {
+            vsapi->freeNode(d->mask_node);
+        }
     };
 
     std::vector<const VSVideoInfo *> in_vis;
@@ -772,20 +1513,51 @@ static void VS_CC vsOrtCreate(
     // match verbosity of vs-trt
     verbosity = static_cast<OrtLoggingLevel>(4 - static_cast<int>(verbosity));
 
+    int prescale = int64ToIntS(vsapi->propGetInt(in, "prescale", 0, &error));
+    if (error) {
+        prescale = 1;
+    }
+    if (prescale < 1) {
+        return set_error("\"prescale\" must be positive");
+    }
+
+    // the network and the tiles see the upscaled clips
+    std::vector<VSVideoInfo> prescaled_vis;
+    if (prescale > 1) {
+        prescaled_vis.reserve(std::size(in_vis));
+        for (auto & vi : in_vis) {
+            auto & prescaled_vi = prescaled_vis.emplace_back(*vi);
+            prescaled_vi.width *= prescale;
+            prescaled_vi.height *= prescale;
+            vi = &prescaled_vi;
+        }
+
+        d->out_vi->width *= prescale;
+        d->out_vi->height *= prescale;
+    }
+
     int error1, error2;
-    d->overlap_w = int64ToIntS(vsapi->propGetInt(in, "overlap", 0, &error1));
-    d->overlap_h = int64ToIntS(vsapi->propGetInt(in, "overlap", 1, &error2));
+    int overlap_w = int64ToIntS(vsapi->propGetInt(in, "overlap", 0, &error1));
+    int overlap_h = int64ToIntS(vsapi->propGetInt(in, "overlap", 1, &error2));
     if (!error1) {
         if (error2) {
-            d->overlap_h = d->overlap_w;
+            overlap_h = overlap_w;
         }
 
-        if (d->overlap_w < 0 || d->overlap_h < 0) {
+        if (overlap_w < 0 || overlap_h < 0) {
             return set_error("\"overlap\" must be non-negative");
         }
     } else {
-        d->overlap_w = 0;
-        d->overlap_h = 0;
+        overlap_w = 0;
+        overlap_h = 0;
+    }
+
+    bool auto_overlap = !!vsapi->propGetInt(in, "auto_overlap", 0, &error);
+    if (error) {
+        auto_overlap = false;
+    }
+    if (auto_overlap && !error1) {
+        return set_error("\"overlap\" and \"auto_overlap\" are mutually exclusive");
     }
 
     size_t tile_w = static_cast<size_t>(vsapi->propGetInt(in, "tilesize", 0, &error1));
@@ -795,7 +1567,7 @@ static void VS_CC vsOrtCreate(
             tile_h = tile_w;
         }
     } else {
-        if (d->overlap_w != 0 || d->overlap_h != 0) {
+        if (overlap_w != 0 || overlap_h != 0 || auto_overlap) {
             return set_error("\"tilesize\" must be specified");
         }
 
@@ -803,10 +1575,190 @@ static void VS_CC vsOrtCreate(
         tile_w = in_vis.front()->width;
         tile_h = in_vis.front()->height;
     }
-    if (tile_w - 2 * d->overlap_w <= 0 || tile_h - 2 * d->overlap_h <= 0) {
+    if (tile_w - 2 * overlap_w <= 0 || tile_h - 2 * overlap_h <= 0) {
         return set_error("\"overlap\" too large");
     }
 
+    int batch = int64ToIntS(vsapi->propGetInt(in, "batch", 0, &error));
+    if (error) {
+        batch = 1;
+    }
+    if (batch <= 0) {
+        return set_error("\"batch\" must be positive");
+    }
+
+    int edge_alignment = int64ToIntS(vsapi->propGetInt(in, "edge_alignment", 0, &error));
+    if (error) {
+        edge_alignment = 0;
+    }
+    if (edge_alignment < 0) {
+        return set_error("\"edge_alignment\" must be non-negative");
+    }
+
+    Padding padding = Padding::None;
+    if (const char * mode = vsapi->propGetData(in, "padding", 0, &error); !error) {
+        if (auto result = parsePadding(mode); result.has_value()) {
+            padding = result.value();
+        } else {
+            return set_error("unknown padding "s + mode);
+        }
+    }
+
+    Blend blend = Blend::None;
+    if (const char * mode = vsapi->propGetData(in, "blend", 0, &error); !error) {
+        if (auto result = parseBlend(mode); result.has_value()) {
+            blend = result.value();
+        } else {
+            return set_error("unknown blend "s + mode);
+        }
+    }
+
+    bool dynamic_batch = !!vsapi->propGetInt(in, "dynamic_batch", 0, &error);
+    if (error) {
+        dynamic_batch = false;
+    }
+
+    int batch_timeout = int64ToIntS(vsapi->propGetInt(in, "batch_timeout", 0, &error));
+    if (error) {
+        batch_timeout = 1000;
+    }
+    if (batch_timeout < 0) {
+        return set_error("\"batch_timeout\" must be non-negative");
+    }
+
+    d->latency_mode = !!vsapi->propGetInt(in, "latency_mode", 0, &error);
+    if (error) {
+        d->latency_mode = false;
+    }
+    if (d->latency_mode && dynamic_batch) {
+        return set_error("\"latency_mode\" and \"dynamic_batch\" are mutually exclusive");
+    }
+
+    d->pipeline = !!vsapi->propGetInt(in, "pipeline", 0, &error);
+    if (error) {
+        d->pipeline = false;
+    }
+
+    int dedup = int64ToIntS(vsapi->propGetInt(in, "dedup", 0, &error));
+    if (error) {
+        dedup = 0;
+    }
+    if (dedup < 0) {
+        return set_error("\"dedup\" must be non-negative");
+    }
+
+    float dedup_threshold = static_cast<float>(vsapi->propGetFloat(in, "dedup_threshold", 0, &error));
+    if (error) {
+        dedup_threshold = 0.f;
+    }
+    if (!(dedup_threshold >= 0.f)) {
+        return set_error("\"dedup_threshold\" must be non-negative");
+    }
+
+    if (dedup > 0) {
+        d->deduplicator = std::make_unique<FrameDeduplicator>();
+        d->deduplicator->capacity = dedup;
+        d->deduplicator->threshold = dedup_threshold;
+    }
+
+    bool tile_cache = !!vsapi->propGetInt(in, "tile_cache", 0, &error);
+    if (error) {
+        tile_cache = false;
+    }
+
+    float tile_cache_threshold = static_cast<float>(vsapi->propGetFloat(in, "tile_cache_threshold", 0, &error));
+    if (error) {
+        tile_cache_threshold = 0.f;
+    }
+    if (!(tile_cache_threshold >= 0.f)) {
+        return set_error("\"tile_cache_threshold\" must be non-negative");
+    }
+
+    if (tile_cache && blend != Blend::None) {
+        return set_error("\"tile_cache\" and \"blend\" are mutually exclusive");
+    }
+
+    if (tile_cache) {
+        d->tile_cache = std::make_unique<TileCache>();
+        d->tile_cache->threshold = tile_cache_threshold;
+    }
+
+    int constant_cache = int64ToIntS(vsapi->propGetInt(in, "constant_cache", 0, &error));
+    if (error) {
+        constant_cache = 0;
+    }
+    if (constant_cache < 0) {
+        return set_error("\"constant_cache\" must be non-negative");
+    }
+
+    if (constant_cache > 0) {
+        d->constant_cache = std::make_unique<ConstantTileCache>();
+        d->constant_cache->capacity = constant_cache;
+    }
+
+    d->mask_node = vsapi->propGetNode(in, "mask", 0, &error);
+    if (error) {
+        d->mask_node = nullptr;
+    }
+
+    if (int num_roi = vsapi->propNumElements(in, "roi"); num_roi != -1) {
+        if (d->mask_node) {
+            return set_error("\"roi\" and \"mask\" are mutually exclusive");
+        }
+        if (num_roi != 4) {
+            return set_error("\"roi\" must be [left, top, width, height]");
+        }
+
+        d->roi = std::make_unique<RegionOfInterest>();
+        d->roi->left = int64ToIntS(vsapi->propGetInt(in, "roi", 0, nullptr));
+        d->roi->top = int64ToIntS(vsapi->propGetInt(in, "roi", 1, nullptr));
+        d->roi->width = int64ToIntS(vsapi->propGetInt(in, "roi", 2, nullptr));
+        d->roi->height = int64ToIntS(vsapi->propGetInt(in, "roi", 3, nullptr));
+
+        if (d->roi->left < 0 || d->roi->top < 0 || d->roi->width <= 0 || d->roi->height <= 0 ||
+            d->roi->left + d->roi->width > in_vis.front()->width ||
+            d->roi->top + d->roi->height > in_vis.front()->height
+        ) {
+            return set_error("\"roi\" must be a non-empty rectangle inside the clip");
+        }
+    } else if (d->mask_node) {
+        const VSVideoInfo * mask_vi = vsapi->getVideoInfo(d->mask_node);
+        if (!mask_vi->format || mask_vi->format->colorFamily != cmGray ||
+            (mask_vi->format->sampleType == stInteger && mask_vi->format->bitsPerSample > 16) ||
+            mask_vi->width != in_vis.front()->width || mask_vi->height != in_vis.front()->height
+        ) {
+            return set_error("\"mask\" must be a GRAY clip of the same dimensions as the input clips");
+        }
+
+        d->roi = std::make_unique<RegionOfInterest>();
+        d->roi->mask_format = getSampleFormat(mask_vi->format);
+    }
+
+    if (d->roi && blend != Blend::None) {
+        return set_error("\"roi\" and \"blend\" are mutually exclusive");
+    }
+
+    // the output of a duplicate frame depends on its mask
+    if (d->mask_node && d->deduplicator) {
+        return set_error("\"mask\" and \"dedup\" are mutually exclusive");
+    }
+
+    if (auto err = parseScalars(in, d->scalars, d->scalar_props, vsapi); err.has_value()) {
+        return set_error(err.value());
+    }
+
+    // the output of a cached frame or tile depends on the properties
+    if (!std::empty(d->scalar_props) &&
+        (d->deduplicator || d->tile_cache || d->constant_cache)
+    ) {
+        return set_error("\"scalar_props\" is not supported by \"dedup\", \"tile_cache\" and \"constant_cache\"");
+    }
+
+    // these read the source of tiles from the clips directly
+    if (prescale > 1 && (d->roi || d->tile_cache || d->constant_cache)) {
+        return set_error("\"prescale\" is not supported by \"roi\", \"mask\", \"tile_cache\" and \"constant_cache\"");
+    }
+
     const char * provider = vsapi->propGetData(in, "provider", 0, &error);
     if (error) {
         provider = "";
@@ -827,6 +1779,10 @@ static void VS_CC vsOrtCreate(
         return set_error("unknwon provider "s + provider);
     }
 
+    if (d->pipeline && d->backend == Backend::CUDA) {
+        return set_error("\"pipeline\" is not supported by the CUDA provider");
+    }
+
     int num_streams = int64ToIntS(vsapi->propGetInt(in, "num_streams", 0, &error));
     if (error) {
         num_streams = 1;
@@ -835,6 +1791,34 @@ static void VS_CC vsOrtCreate(
         return set_error("\"num_streams\" must be positive");
     }
 
+    bool shared_session = !!vsapi->propGetInt(in, "shared_session", 0, &error);
+    if (error) {
+        shared_session = false;
+    }
+
+    std::optional<ThreadPoolConfig> thread_pool;
+    if (int threads = int64ToIntS(vsapi->propGetInt(in, "global_threads", 0, &error)); !error) {
+        if (threads < 0) {
+            return set_error("\"global_threads\" must be non-negative");
+        }
+
+        bool spin = !!vsapi->propGetInt(in, "global_spin", 0, &error);
+        if (error) {
+            spin = true;
+        }
+
+        const char * affinity = vsapi->propGetData(in, "global_affinity", 0, &error);
+        if (error) {
+            affinity = "";
+        }
+
+        thread_pool = ThreadPoolConfig { threads, spin, affinity };
+    } else if (vsapi->propNumElements(in, "global_spin") != -1 ||
+        vsapi->propNumElements(in, "global_affinity") != -1
+    ) {
+        return set_error("\"global_spin\" and \"global_affinity\" require \"global_threads\"");
+    }
+
 #ifdef ENABLE_CUDA
     bool cudnn_benchmark = !!(vsapi->propGetInt(in, "cudnn_benchmark", 0, &error));
     if (error) {
@@ -851,6 +1835,33 @@ static void VS_CC vsOrtCreate(
         fp16 = false;
     }
 
+    bool fp16_io = !!vsapi->propGetInt(in, "fp16_io", 0, &error);
+    if (error) {
+        fp16_io = false;
+    }
+
+    bool half_clips = (
+        in_vis.front()->format->sampleType == stFloat &&
+        in_vis.front()->format->bitsPerSample == 16
+    );
+    if (half_clips && !fp16_io) {
+        return set_error("fp16 clips require \"fp16_io\"");
+    }
+
+    d->tensor_type = fp16_io ? ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16 : ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+    const int tensor_bytes = fp16_io ? sizeof(uint16_t) : sizeof(float);
+
+    bool quantize = !!vsapi->propGetInt(in, "quantize", 0, &error);
+    if (error) {
+        quantize = false;
+    }
+    if (quantize && in_vis.front()->format->sampleType != stInteger) {
+        return set_error("\"quantize\" requires integer input clips");
+    }
+    if (blend != Blend::None && (quantize || half_clips)) {
+        return set_error("\"blend\" requires 32-bit float output clips");
+    }
+
     bool path_is_serialization = !!vsapi->propGetInt(in, "path_is_serialization", 0, &error);
     if (error) {
         path_is_serialization = false;
@@ -861,6 +1872,27 @@ static void VS_CC vsOrtCreate(
         use_cuda_graph = false;
     }
 
+    std::filesystem::path model_cache;
+    if (const char * directory = vsapi->propGetData(in, "model_cache", 0, &error); !error) {
+        // compiled nodes of CoreML can not be serialized
+        if (d->backend == Backend::COREML) {
+            return set_error("\"model_cache\" is not supported by the CoreML provider");
+        }
+
+        model_cache = std::filesystem::u8path(directory);
+
+        std::error_code ec;
+        std::filesystem::create_directories(model_cache, ec);
+        if (ec) {
+            return set_error("\"model_cache\": " + ec.message());
+        }
+    }
+
+    // a captured graph is tied to the tensors of a single stream
+    if (shared_session && use_cuda_graph) {
+        return set_error("\"shared_session\" and \"use_cuda_graph\" are mutually exclusive");
+    }
+
     std::string_view path_view;
     std::string path;
     if (path_is_serialization) {
@@ -882,27 +1914,126 @@ static void VS_CC vsOrtCreate(
         path_view = path;
     }
 
-    auto result = loadONNX(path_view, tile_w, tile_h, path_is_serialization);
-    if (std::holds_alternative<std::string>(result)) {
-        return set_error(std::get<std::string>(result));
+    // preprocessed networks are cached by the contents of the source
+    MappedFile network_file;
+    if (!std::empty(model_cache) && !path_is_serialization) {
+        if (!network_file.open(std::filesystem::u8path(path))) {
+            return set_error("open "s + path + " failed"s);
+        }
+        path_view = network_file.data();
+        path_is_serialization = true;
     }
 
-    auto onnx_model = std::move(std::get<ONNX_NAMESPACE::ModelProto>(result));
+    std::string source_digest;
+    if (!std::empty(model_cache)) {
+        source_digest = sourceDigest(path_view);
+    }
+
+    if (auto_overlap) {
+        std::filesystem::path overlap_path;
+        std::optional<std::array<int, 2>> overlap;
+        if (!std::empty(model_cache)) {
+            overlap_path = overlapPath(model_cache, source_digest, tile_w, tile_h, VERSION);
+            overlap = loadOverlap(overlap_path);
+        }
+
+        if (!overlap.has_value()) {
+            auto result = loadONNX(path_view, tile_w, tile_h, 1, path_is_serialization);
+            if (std::holds_alternative<std::string>(result)) {
+                return set_error(std::get<std::string>(result));
+            }
+
+            auto derived = receptiveFieldOverlap(std::get<ONNX_NAMESPACE::ModelProto>(result));
+            if (std::holds_alternative<std::string>(derived)) {
+                return set_error("\"auto_overlap\": " + std::get<std::string>(derived));
+            }
+            overlap = std::get<std::array<int, 2>>(derived);
+
+            if (!std::empty(model_cache)) {
+                storeOverlap(overlap_path, overlap.value());
+            }
+        }
+        overlap_w = overlap.value()[0];
+        overlap_h = overlap.value()[1];
+
+        if (static_cast<int>(tile_w) - 2 * overlap_w <= 0 || static_cast<int>(tile_h) - 2 * overlap_h <= 0) {
+            return set_error(
+                "\"tilesize\" too small for the receptive field (" +
+                std::to_string(overlap_w) + ", " + std::to_string(overlap_h) + ")"
+            );
+        }
 
-    if (fp16) {
-        convert_float_to_float16(onnx_model, false);
+        auto message = (
+            "ort.Model: overlap set to (" + std::to_string(overlap_w) + ", " +
+            std::to_string(overlap_h) + ")"
+        );
+        vsapi->logMessage(mtDebug, message.c_str());
     }
 
-    std::string onnx_data = onnx_model.SerializeAsString();
-    if (std::size(onnx_data) == 0) {
-        return set_error("proto serialization failed");
+    // there is no point in batching more tiles than a frame has,
+    // unless tiles of different frames are merged
+    if (!dynamic_batch) {
+        batch = std::min(batch, numTiles(
+            in_vis.front()->width, in_vis.front()->height,
+            static_cast<int>(tile_w), static_cast<int>(tile_h),
+            overlap_w, overlap_h
+        ));
+    }
+
+    // shrunk edge tiles require a network of their own
+    const auto shapes = tileShapes(
+        in_vis.front()->width, in_vis.front()->height,
+        static_cast<int>(tile_w), static_cast<int>(tile_h),
+        overlap_w, overlap_h, batch, edge_alignment
+    );
+    const int num_shapes = static_cast<int>(std::size(shapes));
+
+    std::vector<SerializedModel> onnx_data(std::size(shapes)); // per tile shape
+    for (int i = 0; i < num_shapes; ++i) {
+        const auto & shape = shapes[i];
+
+        std::filesystem::path cache_path;
+        if (!std::empty(model_cache)) {
+            cache_path = preprocessedModelPath(
+                model_cache, source_digest, shape.tile_w, shape.tile_h, shape.batch,
+                fp16, fp16_io, VERSION
+            );
+
+            if (onnx_data[i].mapped.open(cache_path) && !std::empty(onnx_data[i].mapped.data())) {
+                continue;
+            }
+        }
+
+        auto result = loadONNX(path_view, shape.tile_w, shape.tile_h, shape.batch, path_is_serialization);
+        if (std::holds_alternative<std::string>(result)) {
+            return set_error(std::get<std::string>(result));
+        }
+
+        auto onnx_model = std::move(std::get<ONNX_NAMESPACE::ModelProto>(result));
+
+        if (fp16) {
+            convert_float_to_float16(onnx_model, false, !fp16_io);
+        }
+
+        onnx_data[i].owned = onnx_model.SerializeAsString();
+        if (std::size(onnx_data[i].owned) == 0) {
+            return set_error("proto serialization failed");
+        }
+
+        if (!std::empty(model_cache)) {
+            storeEntry(cache_path, onnx_data[i].owned);
+        }
     }
 
     // onnxruntime related code
 
-    // environment per filter instance
-    auto logger_id_str = "vs-ort" + std::to_string(logger_id.fetch_add(1, std::memory_order::relaxed));
-    checkError(ortapi->CreateEnv(verbosity, logger_id_str.c_str(), &d->environment));
+    {
+        auto result = getEnvironment(verbosity, thread_pool);
+        if (std::holds_alternative<std::string>(result)) {
+            return set_error(std::get<std::string>(result));
+        }
+        d->environment = std::move(std::get<std::shared_ptr<Environment>>(result));
+    }
 
     OrtMemoryInfo * memory_info;
 #ifdef ENABLE_CUDA
@@ -923,86 +2054,188 @@ static void VS_CC vsOrtCreate(
     OrtAllocator * cpu_allocator;
     checkError(ortapi->GetAllocatorWithDefaultOptions(&cpu_allocator));
 
+    if (d->backend == Backend::CPU) {
+        auto result = getPrepackedWeights();
+        if (std::holds_alternative<std::string>(result)) {
+            return set_error(std::get<std::string>(result));
+        }
+        d->prepacked_weights = std::move(std::get<std::shared_ptr<OrtPrepackedWeightsContainer>>(result));
+    }
+
     // per-stream context
     d->semaphore.current.store(num_streams - 1, std::memory_order_relaxed);
     d->tickets.reserve(num_streams);
     for (int i = 0; i < num_streams; ++i) {
         d->tickets.push_back(i);
     }
-    d->resources.reserve(num_streams);
-    for (int i = 0; i < num_streams; ++i) {
+    d->resources.reserve(num_streams * num_shapes);
+    if (d->latency_mode || d->pipeline) {
+        for (int i = 0; i < num_streams; ++i) {
+            d->workers.push_back(std::make_unique<StreamWorker>());
+        }
+    }
+    if (dynamic_batch) {
+        d->batcher = std::make_unique<DynamicBatcher>();
+        for (const auto & shape : shapes) {
+            d->batcher->max_batch.push_back(shape.batch);
+        }
+        d->batcher->timeout = std::chrono::microseconds(batch_timeout);
+    }
+
+    const size_t memory_before = residentMemory();
+#ifdef ENABLE_CUDA
+    size_t device_free_before {}, device_total {};
+    if (d->backend == Backend::CUDA) {
+        checkCUDAError(cudaMemGetInfo(&device_free_before, &device_total));
+    }
+#endif // ENABLE_CUDA
+
+    for (int i = 0; i < num_streams * num_shapes; ++i) {
+        const auto & shape = shapes[i % num_shapes];
+
         Resource resource;
 
-        OrtSessionOptions * session_options;
-        checkError(ortapi->CreateSessionOptions(&session_options));
-        checkError(ortapi->SetSessionExecutionMode(
-            session_options,
-            ExecutionMode::ORT_SEQUENTIAL
-        ));
-        // checkError(ortapi->EnableMemPattern(session_options));
+        if (shared_session && i >= num_shapes) {
+            // run concurrently with the tensors and bindings of each stream
+            resource.session = d->resources[i % num_shapes].session;
+            resource.owns_session = false;
+#ifdef ENABLE_CUDA
+            resource.require_replay = false;
+#endif // ENABLE_CUDA
+        } else {
+            OrtSessionOptions * session_options;
+            checkError(ortapi->CreateSessionOptions(&session_options));
+            checkError(ortapi->SetSessionExecutionMode(
+                session_options,
+                ExecutionMode::ORT_SEQUENTIAL
+            ));
+            // checkError(ortapi->EnableMemPattern(session_options));
 
-        // TODO: other providers
+            if (thread_pool.has_value()) {
+                checkError(ortapi->DisablePerSessionThreads(session_options));
+            }
+
+            // TODO: other providers
 #ifdef ENABLE_CUDA
-        if (d->backend == Backend::CUDA) {
-            OrtCUDAProviderOptionsV2 * cuda_options;
-            checkError(ortapi->CreateCUDAProviderOptions(&cuda_options));
+            if (d->backend == Backend::CUDA) {
+                OrtCUDAProviderOptionsV2 * cuda_options;
+                checkError(ortapi->CreateCUDAProviderOptions(&cuda_options));
 #ifdef _MSC_VER
-            // Preload cuda dll from vsort directory.
-            static std::once_flag cuda_dll_preloaded_flag;
-            std::call_once(cuda_dll_preloaded_flag, []() {
-                    extern void preloadCudaDlls();
-                    preloadCudaDlls();
-            });
+                // Preload cuda dll from vsort directory.
+                static std::once_flag cuda_dll_preloaded_flag;
+                std::call_once(cuda_dll_preloaded_flag, []() {
+                        extern void preloadCudaDlls();
+                        preloadCudaDlls();
+                });
 #endif // _MSC_VER
-            // should not set 'do_copy_in_default_stream' to false
-            const char * keys [] {
-                "device_id",
-                "cudnn_conv_algo_search",
-                "cudnn_conv_use_max_workspace",
-                "arena_extend_strategy",
-                "enable_cuda_graph"
-            };
-            auto device_id_str = std::to_string(d->device_id);
-            const char * values [] {
-                device_id_str.c_str(),
-                "EXHAUSTIVE",
-                "1",
-                "kSameAsRequested",
-                "0"
-            };
-            if (!cudnn_benchmark) {
-                values[1] = "HEURISTIC";
-            }
-            if (use_cuda_graph) {
-                values[4] = "1";
-                resource.require_replay = true;
-            } else {
-                resource.require_replay = false;
-            }
-            checkError(ortapi->UpdateCUDAProviderOptions(cuda_options, keys, values, std::size(keys)));
+                // should not set 'do_copy_in_default_stream' to false
+                const char * keys [] {
+                    "device_id",
+                    "cudnn_conv_algo_search",
+                    "cudnn_conv_use_max_workspace",
+                    "arena_extend_strategy",
+                    "enable_cuda_graph"
+                };
+                auto device_id_str = std::to_string(d->device_id);
+                const char * values [] {
+                    device_id_str.c_str(),
+                    "EXHAUSTIVE",
+                    "1",
+                    "kSameAsRequested",
+                    "0"
+                };
+                if (!cudnn_benchmark) {
+                    values[1] = "HEURISTIC";
+                }
+                if (use_cuda_graph) {
+                    values[4] = "1";
+                    resource.require_replay = true;
+                } else {
+                    resource.require_replay = false;
+                }
+                checkError(ortapi->UpdateCUDAProviderOptions(cuda_options, keys, values, std::size(keys)));
 
-            checkError(ortapi->SessionOptionsAppendExecutionProvider_CUDA_V2(session_options, cuda_options));
-        }
+                checkError(ortapi->SessionOptionsAppendExecutionProvider_CUDA_V2(session_options, cuda_options));
+            }
 #endif // ENABLE_CUDA
 #ifdef ENABLE_COREML
-        else if (d->backend == Backend::COREML) {
-            checkError(OrtSessionOptionsAppendExecutionProvider_CoreML(
-                session_options,
-                0
-            ));
-        }
+            else if (d->backend == Backend::COREML) {
+                checkError(OrtSessionOptionsAppendExecutionProvider_CoreML(
+                    session_options,
+                    0
+                ));
+            }
 #endif // ENABLE_COREML
 
-        checkError(ortapi->CreateSessionFromArray(
-            d->environment,
-            std::data(onnx_data), std::size(onnx_data),
-            session_options,
-            &resource.session
-        ));
+            // loads the optimized network from the cache, or stores it there
+            // under a temporary name that is renamed once it is complete
+            std::string_view network = onnx_data[i % num_shapes].data();
+            MappedFile cached_network;
+            std::filesystem::path cache_path;
+            std::filesystem::path cache_tmp_path;
+            if (!std::empty(model_cache)) {
+                cache_path = optimizedModelPath(model_cache, network, d->backend, d->device_id);
+
+                if (cached_network.open(cache_path) && !std::empty(cached_network.data())) {
+                    network = cached_network.data();
+                    checkError(ortapi->SetSessionGraphOptimizationLevel(session_options, ORT_DISABLE_ALL));
+                } else {
+                    // not cached if no temporary name can be generated
+                    cache_tmp_path = temporaryPath(cache_path);
+                    if (!std::empty(cache_tmp_path)) {
+                        checkError(ortapi->SetSessionGraphOptimizationLevel(session_options, cached_optimization_level));
+                        checkError(ortapi->SetOptimizedModelFilePath(session_options, cache_tmp_path.c_str()));
+                    }
+                }
+            }
 
-        ortapi->ReleaseSessionOptions(session_options);
+            const auto create_session = [&]() -> std::optional<std::string> {
+                const auto set_error = [](const std::string & error_message) {
+                    return error_message;
+                };
+
+                if (d->prepacked_weights) {
+                    checkError(ortapi->CreateSessionFromArrayWithPrepackedWeightsContainer(
+                        d->environment->env,
+                        std::data(network), std::size(network),
+                        session_options,
+                        d->prepacked_weights.get(),
+                        &resource.session
+                    ));
+                } else {
+                    checkError(ortapi->CreateSessionFromArray(
+                        d->environment->env,
+                        std::data(network), std::size(network),
+                        session_options,
+                        &resource.session
+                    ));
+                }
+
+                return {};
+            };
+            auto err = create_session();
 
-        if (auto err = checkSession(resource.session); err.has_value()) {
+            ortapi->ReleaseSessionOptions(session_options);
+
+            // a failed session may leave a partial network behind
+            if (!cache_tmp_path.empty()) {
+                std::error_code ec;
+                if (!err.has_value()) {
+                    std::filesystem::rename(cache_tmp_path, cache_path, ec);
+                }
+                if (err.has_value() || ec) {
+                    std::filesystem::remove(cache_tmp_path, ec);
+                }
+            }
+
+            if (err.has_value()) {
+                return set_error(err.value());
+            }
+
+            resource.owns_session = true;
+        }
+
+        if (auto err = checkSession(resource.session, shape.batch, d->tensor_type); err.has_value()) {
             return set_error(err.value());
         }
 
@@ -1019,7 +2252,7 @@ static void VS_CC vsOrtCreate(
                 input_shape[1] *
                 input_shape[2] *
                 input_shape[3]
-            ) * sizeof(float);
+            ) * tensor_bytes;
 
             checkCUDAError(cudaMallocHost(
                 &resource.input.h_data, resource.input.size,
@@ -1031,7 +2264,7 @@ static void VS_CC vsOrtCreate(
                 memory_info,
                 resource.input.d_data, resource.input.size,
                 std::data(input_shape), std::size(input_shape),
-                ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &resource.input_tensor
+                d->tensor_type, &resource.input_tensor
             ));
         } else
 #endif // ENALBE_CUDA
@@ -1039,7 +2272,7 @@ static void VS_CC vsOrtCreate(
             checkError(ortapi->CreateTensorAsOrtValue(
                 cpu_allocator,
                 std::data(input_shape), std::size(input_shape),
-                ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT,
+                d->tensor_type,
                 &resource.input_tensor
             ));
         }
@@ -1055,7 +2288,7 @@ static void VS_CC vsOrtCreate(
                 output_shape[1] *
                 output_shape[2] *
                 output_shape[3]
-            ) * sizeof(float);
+            ) * tensor_bytes;
 
             checkCUDAError(cudaMallocHost(&resource.output.h_data, resource.output.size));
             checkCUDAError(cudaMalloc(&resource.output.d_data, resource.output.size));
@@ -1064,7 +2297,7 @@ static void VS_CC vsOrtCreate(
                 memory_info,
                 resource.output.d_data, resource.output.size,
                 std::data(output_shape), std::size(output_shape),
-                ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &resource.output_tensor
+                d->tensor_type, &resource.output_tensor
             ));
         } else
 #endif // ENABLE_CUDA
@@ -1072,7 +2305,7 @@ static void VS_CC vsOrtCreate(
             checkError(ortapi->CreateTensorAsOrtValue(
                 cpu_allocator,
                 std::data(output_shape), std::size(output_shape),
-                ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT,
+                d->tensor_type,
                 &resource.output_tensor
             ));
         }
@@ -1092,17 +2325,105 @@ static void VS_CC vsOrtCreate(
         checkError(ortapi->BindInput(resource.binding, input_name, resource.input_tensor));
         checkError(ortapi->BindOutput(resource.binding, output_name, resource.output_tensor));
 
-        if (auto err = checkNodesAndNetwork(resource.session, in_vis); err.has_value()) {
+        if (i == 0) {
+            d->input_name = input_name;
+            d->output_name = output_name;
+        }
+
+        resource.back_input_tensor = nullptr;
+        resource.back_output_tensor = nullptr;
+        resource.back_binding = nullptr;
+        if (d->pipeline) {
+            checkError(ortapi->CreateTensorAsOrtValue(
+                cpu_allocator,
+                std::data(input_shape), std::size(input_shape),
+                d->tensor_type,
+                &resource.back_input_tensor
+            ));
+            checkError(ortapi->CreateTensorAsOrtValue(
+                cpu_allocator,
+                std::data(output_shape), std::size(output_shape),
+                d->tensor_type,
+                &resource.back_output_tensor
+            ));
+
+            checkError(ortapi->CreateIoBinding(resource.session, &resource.back_binding));
+            checkError(ortapi->BindInput(resource.back_binding, input_name, resource.back_input_tensor));
+            checkError(ortapi->BindOutput(resource.back_binding, output_name, resource.back_output_tensor));
+        }
+
+        checkError(ortapi->AllocatorFree(cpu_allocator, input_name));
+        checkError(ortapi->AllocatorFree(cpu_allocator, output_name));
+
+        if (auto err = checkNodesAndNetwork(
+            resource.session, in_vis, static_cast<int>(std::size(d->scalars)), padding != Padding::None
+        ); err.has_value()) {
             return set_error(err.value());
         }
 
         if (i == 0) {
             setDimensions(d->out_vi, input_shape, output_shape, core, vsapi);
+
+            if (quantize) {
+                d->out_vi->format = vsapi->registerFormat(
+                    d->out_vi->format->colorFamily, stInteger,
+                    in_vis.front()->format->bitsPerSample, 0, 0, core
+                );
+            } else if (half_clips) {
+                d->out_vi->format = vsapi->registerFormat(
+                    d->out_vi->format->colorFamily, stFloat, 16, 0, 0, core
+                );
+            }
+
+            d->plan = makeTilePlan(
+                in_vis.front()->width, in_vis.front()->height,
+                static_cast<int>(input_shape[1]) - static_cast<int>(std::size(d->scalars)),
+                getSampleFormat(in_vis.front()->format),
+                static_cast<int>(output_shape[1]), getSampleFormat(d->out_vi->format),
+                static_cast<int>(input_shape[3]), static_cast<int>(input_shape[2]),
+                overlap_w, overlap_h,
+                static_cast<int>(output_shape[3] / input_shape[3]),
+                static_cast<int>(output_shape[2] / input_shape[2]),
+                batch, tensor_bytes, edge_alignment, padding, blend,
+                static_cast<int>(std::size(d->scalars)), prescale
+            );
+
+            if (d->roi && d->plan.src_planes != d->plan.dst_planes) {
+                return set_error("\"roi\" and \"mask\" require as many output planes as input planes");
+            }
+
+            if (d->plan.saved_pixels > 0) {
+                auto message = (
+                    "ort.Model: edge tiles save "s + std::to_string(d->plan.saved_pixels) +
+                    " input pixels per plane and frame"
+                );
+                vsapi->logMessage(mtDebug, message.c_str());
+            }
         }
 
         d->resources.push_back(resource);
     }
 
+    {
+        const auto mebibytes = [](size_t before, size_t after) {
+            return std::to_string((static_cast<int64_t>(after) - static_cast<int64_t>(before)) / (1 << 20));
+        };
+
+        auto message = (
+            "ort.Model: "s + std::to_string(shared_session ? num_shapes : num_streams * num_shapes) +
+            " sessions for " + std::to_string(num_streams) + " streams, resident memory " +
+            mebibytes(memory_before, residentMemory()) + " MiB"
+        );
+#ifdef ENABLE_CUDA
+        if (d->backend == Backend::CUDA) {
+            size_t device_free_after;
+            checkCUDAError(cudaMemGetInfo(&device_free_after, &device_total));
+            message += ", device memory " + mebibytes(device_free_after, device_free_before) + " MiB";
+        }
+#endif // ENABLE_CUDA
+        vsapi->logMessage(mtDebug, message.c_str());
+    }
+
     ortapi->ReleaseMemoryInfo(memory_info);
 
     vsapi->createFilter(
@@ -1141,6 +2462,32 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit(
         "fp16:int:opt;"
         "path_is_serialization:int:opt;"
         "use_cuda_graph:int:opt;"
+        "auto_overlap:int:opt;"
+        "batch:int:opt;"
+        "edge_alignment:int:opt;"
+        "padding:data:opt;"
+        "blend:data:opt;"
+        "dynamic_batch:int:opt;"
+        "batch_timeout:int:opt;"
+        "latency_mode:int:opt;"
+        "pipeline:int:opt;"
+        "dedup:int:opt;"
+        "dedup_threshold:float:opt;"
+        "tile_cache:int:opt;"
+        "tile_cache_threshold:float:opt;"
+        "constant_cache:int:opt;"
+        "roi:int[]:opt;"
+        "mask:clip:opt;"
+        "scalars:float[]:opt;"
+        "scalar_props:data[]:opt;"
+        "prescale:int:opt;"
+        "quantize:int:opt;"
+        "fp16_io:int:opt;"
+        "shared_session:int:opt;"
+        "global_threads:int:opt;"
+        "global_spin:int:opt;"
+        "global_affinity:data:opt;"
+        "model_cache:data:opt;"
         , vsOrtCreate,
         nullptr,
         plugin
@@ -1,6 +1,7 @@
 #ifdef _MSC_VER
 #include <windows.h>
 #include <delayimp.h>
+#include <psapi.h>
 #include <iostream>
 #include <map>
 #include <string>
@@ -145,4 +146,11 @@ void preloadCudaDlls() {
             std::wcerr << DLL_DIR << L": preloading " << p << L": " << h << std::endl;
     }
 }
+
+size_t residentMemory() noexcept {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return counters.WorkingSetSize;
+}
 #endif
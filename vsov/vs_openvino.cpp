@@ -1,5 +1,6 @@
 #include <array>
 #include <cstdint>
+#include <filesystem>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -27,18 +28,30 @@
 #endif // ENABLE_VISUALIZATION
 
 #include "config.h"
+#include "../common/constant_tile_cache.h"
+#include "../common/frame_deduplicator.h"
+#include "../common/onnx_cache.h"
+#include "../common/roi.h"
+#include "../common/tile_cache.h"
+#include "../common/tiling.h"
 
 
 extern std::variant<std::string, ONNX_NAMESPACE::ModelProto> loadONNX(
     const std::string_view & path,
     int64_t tile_w,
     int64_t tile_h,
+    int64_t batch,
     bool path_is_serialization
 ) noexcept;
 
+extern std::variant<std::string, std::array<int, 2>> receptiveFieldOverlap(
+    const ONNX_NAMESPACE::ModelProto & model
+) noexcept;
+
 extern void convert_float_to_float16(
     ONNX_NAMESPACE::ModelProto & model,
-    bool force_fp16_initializers
+    bool force_fp16_initializers,
+    bool keep_io_types
 ) noexcept;
 
 
@@ -83,14 +96,83 @@ static int numPlanes(
 }
 
 
+[[nodiscard]]
+static std::optional<std::string> parseScalars(
+    const VSMap * in,
+    std::vector<float> & scalars,
+    std::vector<std::string> & scalar_props,
+    const VSAPI * vsapi
+) {
+
+    int num_scalars = vsapi->propNumElements(in, "scalars");
+    for (int i = 0; i < num_scalars; ++i) {
+        scalars.push_back(static_cast<float>(vsapi->propGetFloat(in, "scalars", i, nullptr)));
+    }
+
+    int num_props = vsapi->propNumElements(in, "scalar_props");
+    if (num_props == -1) {
+        return {};
+    }
+    if (num_props != static_cast<int>(std::size(scalars))) {
+        return "\"scalar_props\" must have as many elements as \"scalars\"";
+    }
+
+    bool named = false;
+    for (int i = 0; i < num_props; ++i) {
+        scalar_props.emplace_back(vsapi->propGetData(in, "scalar_props", i, nullptr));
+        named = named || !std::empty(scalar_props.back());
+    }
+
+    // constant channels only
+    if (!named) {
+        scalar_props.clear();
+    }
+
+    return {};
+}
+
+
+// keeps `value` if the frame has no such numeric property
+static void readScalarProp(
+    const VSMap * props,
+    const std::string & name,
+    float & value,
+    const VSAPI * vsapi
+) {
+
+    if (std::empty(name)) {
+        return;
+    }
+
+    int error;
+    double prop = vsapi->propGetFloat(props, name.c_str(), 0, &error);
+    if (error) {
+        prop = static_cast<double>(vsapi->propGetInt(props, name.c_str(), 0, &error));
+    }
+    if (!error) {
+        value = static_cast<float>(prop);
+    }
+}
+
+
 [[nodiscard]]
 static std::optional<std::string> checkNodes(
     const std::vector<const VSVideoInfo *> & vis
 ) {
 
     for (const auto & vi : vis) {
-        if (vi->format->sampleType != stFloat || vi->format->bitsPerSample != 32) {
-            return "expects clip with type fp32";
+        bool is_float = vi->format->sampleType == stFloat && (
+            vi->format->bitsPerSample == 32 || vi->format->bitsPerSample == 16
+        );
+        bool is_integer = vi->format->sampleType == stInteger && vi->format->bitsPerSample <= 16;
+        if (!is_float && !is_integer) {
+            return "expects clip with type fp16, fp32 or 8-16 bit integer";
+        }
+
+        if (vi->format->sampleType != vis[0]->format->sampleType ||
+            vi->format->bitsPerSample != vis[0]->format->bitsPerSample
+        ) {
+            return "sample types of clips mismatch";
         }
 
         if (vi->width != vis[0]->width || vi->height != vis[0]->height) {
@@ -114,11 +196,17 @@ template <typename T>
 [[nodiscard]]
 static std::optional<std::string> checkIOInfo(
     const T & info,
-    bool is_output
+    bool is_output,
+    int batch,
+    InferenceEngine::Precision precision
 ) {
 
-    if (info->getPrecision() != InferenceEngine::Precision::FP32) {
-        return "expects network IO with type fp32";
+    if (info->getPrecision() != precision) {
+        if (precision == InferenceEngine::Precision::FP16) {
+            return "expects network IO with type fp16";
+        } else {
+            return "expects network IO with type fp32";
+        }
     }
     const auto & desc = info->getTensorDesc();
     if (desc.getLayout() != InferenceEngine::Layout::NCHW) {
@@ -129,8 +217,8 @@ static std::optional<std::string> checkIOInfo(
         return "expects network with 4-D IO";
     }
 
-    if (dims[0] != 1) {
-        return "batch size of network must be 1";
+    if (dims[0] != static_cast<size_t>(batch)) {
+        return "batch size of network must be " + std::to_string(batch);
     }
 
     if (is_output) {
@@ -146,7 +234,9 @@ static std::optional<std::string> checkIOInfo(
 
 [[nodiscard]]
 static std::optional<std::string> checkNetwork(
-    const InferenceEngine::CNNNetwork & network
+    const InferenceEngine::CNNNetwork & network,
+    int batch,
+    InferenceEngine::Precision precision
 ) {
 
     const auto & inputs_info = network.getInputsInfo();
@@ -156,7 +246,7 @@ static std::optional<std::string> checkNetwork(
     }
 
     const auto & input_info = inputs_info.cbegin()->second;
-    if (auto err = checkIOInfo(input_info, false); err.has_value()) {
+    if (auto err = checkIOInfo(input_info, false, batch, precision); err.has_value()) {
         return err.value();
     }
 
@@ -167,7 +257,7 @@ static std::optional<std::string> checkNetwork(
     }
 
     const auto & output_info = outputs_info.cbegin()->second;
-    if (auto err = checkIOInfo(output_info, true); err.has_value()) {
+    if (auto err = checkIOInfo(output_info, true, batch, precision); err.has_value()) {
         return err.value();
     }
 
@@ -178,7 +268,9 @@ static std::optional<std::string> checkNetwork(
 [[nodiscard]]
 static std::optional<std::string> checkNodesAndNetwork(
     const InferenceEngine::ExecutableNetwork & network,
-    const std::vector<const VSVideoInfo *> & vis
+    const std::vector<const VSVideoInfo *> & vis,
+    int num_scalars,
+    bool padding
 ) {
 
     const auto & network_in_dims = (
@@ -187,15 +279,15 @@ static std::optional<std::string> checkNodesAndNetwork(
 
     int network_in_channels = static_cast<int>(network_in_dims[1]);
     int num_planes = numPlanes(vis);
-    if (network_in_channels != num_planes) {
-        return "expects " + std::to_string(network_in_channels) + " input planes";
+    if (network_in_channels != num_planes + num_scalars) {
+        return "expects " + std::to_string(network_in_channels - num_scalars) + " input planes";
     }
 
     auto network_in_height = static_cast<int>(network_in_dims[2]);
     auto network_in_width = static_cast<int>(network_in_dims[3]);
     auto clip_in_height = vis.front()->height;
     auto clip_in_width = vis.front()->width;
-    if (network_in_height > clip_in_height || network_in_width > clip_in_width) {
+    if (!padding && (network_in_height > clip_in_height || network_in_width > clip_in_width)) {
         return "tile size larger than clip dimension";
     }
 
@@ -281,13 +373,37 @@ struct OVData {
     std::vector<VSNodeRef *> nodes;
     std::unique_ptr<VSVideoInfo> out_vi;
 
-    int overlap_w, overlap_h;
+    TilePlan plan;
 
     InferenceEngine::Core core;
-    InferenceEngine::ExecutableNetwork executable_network;
-    std::unordered_map<std::thread::id, InferenceEngine::InferRequest> infer_requests;
+    std::vector<InferenceEngine::ExecutableNetwork> executable_networks; // per tile shape
+    // one request per thread and tile shape, or two if pipelined,
+    // the requests of a tile shape are adjacent
+    std::unordered_map<std::thread::id, std::vector<InferenceEngine::InferRequest>> infer_requests;
     std::shared_mutex infer_requests_lock;
 
+    // overlaps copies of adjacent batches with inference
+    bool pipeline;
+
+    // reuses the output of duplicate frames, disabled if null
+    std::unique_ptr<FrameDeduplicator> deduplicator;
+
+    // reuses the output of unchanged tiles, disabled if null
+    std::unique_ptr<TileCache> tile_cache;
+
+    // reuses the output of constant tiles, disabled if null
+    std::unique_ptr<ConstantTileCache> constant_cache;
+
+    // infers the tiles of a rectangle or of a mask only, disabled if null
+    std::unique_ptr<RegionOfInterest> roi;
+    VSNodeRef * mask_node {};
+
+    // values of the input channels that follow the planes of the clips,
+    // read from the frame property of the first clip if it is named
+    std::vector<float> scalars;
+    std::vector<std::string> scalar_props;
+    ScalarChannelCache scalar_cache;
+
     std::string input_name;
     std::string output_name;
 };
@@ -323,6 +439,9 @@ static const VSFrameRef *VS_CC vsOvGetFrame(
         for (const auto & node : d->nodes) {
             vsapi->requestFrameFilter(n, node, frameCtx);
         }
+        if (d->mask_node) {
+            vsapi->requestFrameFilter(n, d->mask_node, frameCtx);
+        }
     } else if (activationReason == arAllFramesReady) {
         std::vector<const VSVideoInfo *> in_vis;
         in_vis.reserve(std::size(d->nodes));
@@ -336,47 +455,42 @@ static const VSFrameRef *VS_CC vsOvGetFrame(
             src_frames.emplace_back(vsapi->getFrameFilter(n, node, frameCtx));
         }
 
+        std::shared_ptr<FrameDeduplicator::Entry> dedup_entry;
+        if (d->deduplicator) {
+            auto output = d->deduplicator->acquire(src_frames, dedup_entry, vsapi);
+            if (output) {
+                VSFrameRef * dst_frame = vsapi->copyFrame(output, core);
+                vsapi->copyFrameProps(src_frames.front(), dst_frame, core);
+                vsapi->freeFrame(output);
+
+                for (const auto & frame : src_frames) {
+                    vsapi->freeFrame(frame);
+                }
+
+                return dst_frame;
+            }
+        }
+
         auto src_stride = vsapi->getStride(src_frames.front(), 0);
-        auto src_width = vsapi->getFrameWidth(src_frames.front(), 0);
-        auto src_height = vsapi->getFrameHeight(src_frames.front(), 0);
-        auto src_bytes = vsapi->getFrameFormat(src_frames.front())->bytesPerSample;
-        auto src_tile_shape = getShape(d->executable_network, true);
-        auto src_tile_h = src_tile_shape[2];
-        auto src_tile_w = src_tile_shape[3];
-        auto src_tile_w_bytes = src_tile_w * src_bytes;
-        auto src_tile_bytes = src_tile_h * src_tile_w_bytes;
 
         std::vector<const uint8_t *> src_ptrs;
-        src_ptrs.reserve(src_tile_shape[1]);
+        src_ptrs.reserve(d->plan.src_planes);
         for (unsigned i = 0; i < std::size(d->nodes); ++i) {
             for (int j = 0; j < in_vis[i]->format->numPlanes; ++j) {
                 src_ptrs.emplace_back(vsapi->getReadPtr(src_frames[i], j));
             }
         }
 
-        auto step_w = src_tile_w - 2 * d->overlap_w;
-        auto step_h = src_tile_h - 2 * d->overlap_h;
-
         VSFrameRef * const dst_frame = vsapi->newVideoFrame(
             d->out_vi->format, d->out_vi->width, d->out_vi->height,
             src_frames.front(), core
         );
         auto dst_stride = vsapi->getStride(dst_frame, 0);
-        auto dst_bytes = vsapi->getFrameFormat(dst_frame)->bytesPerSample;
-        auto dst_tile_shape = getShape(d->executable_network, false);
-        auto dst_tile_h = dst_tile_shape[2];
-        auto dst_tile_w = dst_tile_shape[3];
-        auto dst_tile_w_bytes = dst_tile_w * dst_bytes;
-        auto dst_tile_bytes = dst_tile_h * dst_tile_w_bytes;
-        auto dst_planes = dst_tile_shape[1];
         std::array<uint8_t *, 3> dst_ptrs {};
-        for (int i = 0; i < dst_planes; ++i) {
+        for (int i = 0; i < d->plan.dst_planes; ++i) {
             dst_ptrs[i] = vsapi->getWritePtr(dst_frame, i);
         }
 
-        auto h_scale = dst_tile_h / src_tile_h;
-        auto w_scale = dst_tile_w / src_tile_w;
-
         const auto set_error = [&](const std::string & error_message) {
             vsapi->setFilterError(
                 (__func__ + ": "s + error_message).c_str(),
@@ -389,117 +503,282 @@ static const VSFrameRef *VS_CC vsOvGetFrame(
                 vsapi->freeFrame(frame);
             }
 
+            if (dedup_entry) {
+                d->deduplicator->finish(dedup_entry, nullptr, vsapi);
+            }
+
             return nullptr;
         };
 
         auto thread_id = std::this_thread::get_id();
         bool initialized = true;
-        InferenceEngine::InferRequest * infer_request;
+        std::vector<InferenceEngine::InferRequest> * infer_requests;
 
         d->infer_requests_lock.lock_shared();
         try {
-            infer_request = &d->infer_requests.at(thread_id);
+            infer_requests = &d->infer_requests.at(thread_id);
         } catch (const std::out_of_range &) {
             initialized = false;
         }
         d->infer_requests_lock.unlock_shared();
 
         if (!initialized) {
-            std::lock_guard _ { d->infer_requests_lock };
+            std::vector<InferenceEngine::InferRequest> requests;
             try {
-                d->infer_requests.emplace(thread_id, d->executable_network.CreateInferRequest());
+                for (auto & executable_network : d->executable_networks) {
+                    requests.push_back(executable_network.CreateInferRequest());
+                    if (d->pipeline) {
+                        requests.push_back(executable_network.CreateInferRequest());
+                    }
+                }
             } catch (const InferenceEngine::Exception& e) {
                 return set_error("[IE exception] Create inference request: "s + e.what());
             } catch (const std::exception& e) {
                 return set_error("[Standard exception] Create inference request: "s + e.what());
             }
-            infer_request = &d->infer_requests[thread_id];
+
+            std::lock_guard _ { d->infer_requests_lock };
+            infer_requests = &d->infer_requests.emplace(thread_id, std::move(requests)).first->second;
+        }
+
+        clearBlendTarget(d->plan, std::data(dst_ptrs), dst_stride);
+
+        std::vector<float> scalars = d->scalars;
+        if (!std::empty(d->scalar_props)) {
+            const VSMap * props = vsapi->getFramePropsRO(src_frames.front());
+            for (unsigned i = 0; i < std::size(scalars); ++i) {
+                readScalarProp(props, d->scalar_props[i], scalars[i], vsapi);
+            }
+        }
+
+        const FrameIO io {
+            std::data(src_ptrs), src_stride, std::data(dst_ptrs), dst_stride, nullptr,
+            std::data(scalars), &d->scalar_cache
+        };
+
+        std::vector<TileJob> jobs;
+        jobs.reserve(std::size(d->plan.tiles));
+        for (const auto & tile : d->plan.tiles) {
+            jobs.push_back(TileJob { &tile, &io });
+        }
+
+        int skipped_tiles = 0;
+        if (d->roi) {
+            const VSFrameRef * mask_frame = nullptr;
+            if (d->mask_node) {
+                mask_frame = vsapi->getFrameFilter(n, d->mask_node, frameCtx);
+            }
+
+            skipped_tiles = d->roi->select(
+                d->plan, jobs,
+                mask_frame ? vsapi->getReadPtr(mask_frame, 0) : nullptr,
+                mask_frame ? vsapi->getStride(mask_frame, 0) : 0
+            );
+
+            vsapi->freeFrame(mask_frame);
+        }
+
+        std::vector<uint64_t> tile_hashes;
+        if (d->tile_cache) {
+            skipped_tiles += d->tile_cache->reuse(d->plan, jobs, tile_hashes);
+        }
+
+        ConstantTileCache::Pending constant_tiles;
+        if (d->constant_cache) {
+            skipped_tiles += d->constant_cache->reuse(d->plan, jobs, constant_tiles);
         }
 
-        int y = 0;
-        while (true) {
-            int y_crop_start = (y == 0) ? 0 : d->overlap_h;
-            int y_crop_end = (y == src_height - src_tile_h) ? 0 : d->overlap_h;
+        const auto finish_frame = [&]() {
+            if (d->constant_cache) {
+                d->constant_cache->finish(d->plan, constant_tiles);
+            }
+
+            if (d->tile_cache) {
+                d->tile_cache->update(d->plan, jobs, tile_hashes);
+            }
+
+            if (d->roi || d->tile_cache || d->constant_cache) {
+                vsapi->propSetFloat(
+                    vsapi->getFramePropsRW(dst_frame), "MLRTTileSkipRatio",
+                    static_cast<double>(skipped_tiles) / std::size(d->plan.tiles),
+                    paReplace
+                );
+            }
+
+            if (dedup_entry) {
+                d->deduplicator->finish(dedup_entry, dst_frame, vsapi);
+            }
+
+            for (const auto & frame : src_frames) {
+                vsapi->freeFrame(frame);
+            }
+
+            return dst_frame;
+        };
+
+        const auto pack = [&](InferenceEngine::InferRequest & request, const TileBatch & batch) {
+            InferenceEngine::Blob::Ptr input = request.GetBlob(d->input_name);
+
+            auto minput = input->as<InferenceEngine::MemoryBlob>();
+            auto minputHolder = minput->wmap();
+            uint8_t * input_buffer = minputHolder.as<uint8_t *>();
+
+            packBatch(d->plan, &jobs[batch.first], batch.count, input_buffer);
+        };
+
+        const auto unpack = [&](InferenceEngine::InferRequest & request, const TileBatch & batch) {
+            InferenceEngine::Blob::CPtr output = request.GetBlob(d->output_name);
 
-            int x = 0;
-            while (true) {
-                int x_crop_start = (x == 0) ? 0 : d->overlap_w;
-                int x_crop_end = (x == src_width - src_tile_w) ? 0 : d->overlap_w;
+            auto moutput = output->as<const InferenceEngine::MemoryBlob>();
+            auto moutputHolder = moutput->rmap();
+            const uint8_t * output_buffer = moutputHolder.as<const uint8_t *>();
 
-                {
-                    InferenceEngine::Blob::Ptr input = infer_request->GetBlob(d->input_name);
+            unpackBatch(d->plan, &jobs[batch.first], batch.count, output_buffer);
+        };
+
+        // the batches of the tiles that are left
+        const auto batches = (skipped_tiles == 0) ? d->plan.batches : makeBatches(
+            d->plan.shapes, static_cast<int>(std::size(jobs)),
+            [&jobs](int i) { return jobs[i].tile->shape; }
+        );
+        const int num_batches = static_cast<int>(std::size(batches));
+        auto & requests = *infer_requests;
+
+        // a single plane is a NCHW tensor on its own if its rows are dense
+        // and its samples have the element type of the tensor,
+        // so a frame covered by a single tile is wrapped into user blobs
+        bool single_tile = (
+            std::size(jobs) == 1 && !isPadded(d->plan, *jobs[0].tile) &&
+            !jobs[0].output_copy
+        );
+        bool bind_src = (
+            single_tile && d->plan.src_planes == 1 && d->plan.scalar_channels == 0 &&
+            d->plan.prescale == 1 && d->plan.src_format.is_float &&
+            d->plan.src_format.bytes == d->plan.tensor_bytes &&
+            static_cast<size_t>(src_stride) == d->plan.src_tile_w_bytes
+        );
+        bool bind_dst = (
+            single_tile && d->plan.dst_planes == 1 && d->plan.dst_format.is_float &&
+            d->plan.dst_format.bytes == d->plan.tensor_bytes &&
+            static_cast<size_t>(dst_stride) == d->plan.dst_tile_w_bytes
+        );
 
-                    auto minput = input->as<InferenceEngine::MemoryBlob>();
-                    auto minputHolder = minput->wmap();
-                    uint8_t * input_buffer = minputHolder.as<uint8_t *>();
+        const auto wrap = [&](const InferenceEngine::TensorDesc & desc, uint8_t * ptr) {
+            InferenceEngine::Blob::Ptr blob;
+            if (d->plan.tensor_bytes == sizeof(float)) {
+                blob = InferenceEngine::make_shared_blob<float>(desc, reinterpret_cast<float *>(ptr));
+            } else {
+                blob = InferenceEngine::make_shared_blob<InferenceEngine::ie_fp16>(
+                    desc, reinterpret_cast<InferenceEngine::ie_fp16 *>(ptr)
+                );
+            }
+            return blob;
+        };
 
-                    for (const auto & _src_ptr : src_ptrs) {
-                        const uint8_t * src_ptr { _src_ptr +
-                            y * src_stride + x * src_bytes
-                        };
+        if (bind_src || bind_dst) {
+            auto & request = requests[0];
 
-                        vs_bitblt(
-                            input_buffer, src_tile_w_bytes,
-                            src_ptr, src_stride,
-                            src_tile_w_bytes, src_tile_h
-                        );
+            InferenceEngine::Blob::Ptr input;
+            InferenceEngine::Blob::Ptr output;
 
-                        input_buffer += src_tile_bytes;
+            // the frame must not stay bound to the request after failures
+            const auto restore = [&]() noexcept {
+                try {
+                    if (input) {
+                        request.SetBlob(d->input_name, input);
                     }
+                    if (output) {
+                        request.SetBlob(d->output_name, output);
+                    }
+                } catch (...) {
                 }
+            };
 
-                try {
-                    infer_request->Infer();
-                } catch (const InferenceEngine::Exception & e) {
-                    return set_error("[IE exception] Create inference request: "s + e.what());
-                } catch (const std::exception& e) {
-                    return set_error("[Standard exception] Create inference request: "s + e.what());
+            try {
+                input = request.GetBlob(d->input_name);
+                output = request.GetBlob(d->output_name);
+
+                if (bind_src) {
+                    request.SetBlob(d->input_name, wrap(
+                        input->getTensorDesc(), const_cast<uint8_t *>(src_ptrs[0])
+                    ));
+                } else {
+                    pack(request, batches[0]);
+                }
+
+                if (bind_dst) {
+                    request.SetBlob(d->output_name, wrap(output->getTensorDesc(), dst_ptrs[0]));
                 }
 
-                {
-                    InferenceEngine::Blob::CPtr output = infer_request->GetBlob(d->output_name);
+                request.Infer();
 
-                    auto moutput = output->as<const InferenceEngine::MemoryBlob>();
-                    auto moutputHolder = moutput->rmap();
-                    const uint8_t * output_buffer = moutputHolder.as<const uint8_t *>();
+                // restores the request's own blobs
+                request.SetBlob(d->input_name, input);
+                request.SetBlob(d->output_name, output);
 
-                    for (int plane = 0; plane < dst_planes; ++plane) {
-                        uint8_t * dst_ptr = (dst_ptrs[plane] +
-                            h_scale * y * dst_stride + w_scale * x * dst_bytes
-                        );
+                if (!bind_dst) {
+                    unpack(request, batches[0]);
+                }
+            } catch (const InferenceEngine::Exception & e) {
+                restore();
+                return set_error("[IE exception] Create inference request: "s + e.what());
+            } catch (const std::exception& e) {
+                restore();
+                return set_error("[Standard exception] Create inference request: "s + e.what());
+            }
+
+            return finish_frame();
+        }
 
-                        vs_bitblt(
-                            dst_ptr + (y_crop_start * dst_stride + x_crop_start * dst_bytes),
-                            dst_stride,
-                            output_buffer + (y_crop_start * dst_tile_w_bytes + x_crop_start * dst_bytes),
-                            dst_tile_w_bytes,
-                            dst_tile_w_bytes - (x_crop_start + x_crop_end) * dst_bytes,
-                            dst_tile_h - (y_crop_start + y_crop_end)
-                        );
+        // with two requests per tile shape, the next batch is packed and
+        // the previous one is unpacked while the current one is inferred
+        const int shape_requests = d->pipeline ? 2 : 1;
+        const bool pipelined = d->pipeline && num_batches > 1;
 
-                        output_buffer += dst_tile_bytes;
-                    }
+        const auto request_of = [&](int k) -> InferenceEngine::InferRequest & {
+            return requests[batches[k].shape * shape_requests + (pipelined ? k % 2 : 0)];
+        };
+
+        if (pipelined) {
+            pack(request_of(0), batches[0]);
+        }
+
+        for (int k = 0; k < num_batches; ++k) {
+            auto & request = request_of(k);
+
+            try {
+                if (!pipelined) {
+                    pack(request, batches[k]);
                 }
 
-                if (x + src_tile_w == src_width) {
-                    break;
+                request.StartAsync();
+
+                if (pipelined) {
+                    if (k > 0) {
+                        unpack(request_of(k - 1), batches[k - 1]);
+                    }
+                    if (k + 1 < num_batches) {
+                        pack(request_of(k + 1), batches[k + 1]);
+                    }
                 }
 
-                x = std::min(x + step_w, src_width - src_tile_w);
-            }
+                request.Wait(InferenceEngine::InferRequest::WaitMode::RESULT_READY);
 
-            if (y + src_tile_h == src_height) {
-                break;
+                if (!pipelined) {
+                    unpack(request, batches[k]);
+                }
+            } catch (const InferenceEngine::Exception & e) {
+                return set_error("[IE exception] Create inference request: "s + e.what());
+            } catch (const std::exception& e) {
+                return set_error("[Standard exception] Create inference request: "s + e.what());
             }
-
-            y = std::min(y + step_h, src_height - src_tile_h);
         }
 
-        for (const auto & frame : src_frames) {
-            vsapi->freeFrame(frame);
+        if (pipelined) {
+            unpack(request_of(num_batches - 1), batches[num_batches - 1]);
         }
 
-        return dst_frame;
+        return finish_frame();
     }
 
     return nullptr;
@@ -518,6 +797,14 @@ static void VS_CC vsOvFree(
         vsapi->freeNode(node);
     }
 
+    if (d->mask_node) {
+        vsapi->freeNode(d->mask_node);
+    }
+
+    if (d->deduplicator) {
+        d->deduplicator->clear();
+    }
+
     delete d;
 }
 
@@ -553,6 +840,9 @@ static void VS_CC vsOvCreate(
         for (const auto & node : d->nodes) {
             vsapi->freeNode(node);
         }
+        if (d->mask_node) {
+            vsapi->freeNode(d->mask_node);
+        }
     };
 
     std::vector<const VSVideoInfo *> in_vis;
@@ -574,20 +864,51 @@ static void VS_CC vsOvCreate(
         device = "CPU";
     }
 
+    int prescale = int64ToIntS(vsapi->propGetInt(in, "prescale", 0, &error));
+    if (error) {
+        prescale = 1;
+    }
+    if (prescale < 1) {
+        return set_error("\"prescale\" must be positive");
+    }
+
+    // the network and the tiles see the upscaled clips
+    std::vector<VSVideoInfo> prescaled_vis;
+    if (prescale > 1) {
+        prescaled_vis.reserve(std::size(in_vis));
+        for (auto & vi : in_vis) {
+            auto & prescaled_vi = prescaled_vis.emplace_back(*vi);
+            prescaled_vi.width *= prescale;
+            prescaled_vi.height *= prescale;
+            vi = &prescaled_vi;
+        }
+
+        d->out_vi->width *= prescale;
+        d->out_vi->height *= prescale;
+    }
+
     int error1, error2;
-    d->overlap_w = int64ToIntS(vsapi->propGetInt(in, "overlap", 0, &error1));
-    d->overlap_h = int64ToIntS(vsapi->propGetInt(in, "overlap", 1, &error2));
+    int overlap_w = int64ToIntS(vsapi->propGetInt(in, "overlap", 0, &error1));
+    int overlap_h = int64ToIntS(vsapi->propGetInt(in, "overlap", 1, &error2));
     if (!error1) {
         if (error2) {
-            d->overlap_h = d->overlap_w;
+            overlap_h = overlap_w;
         }
 
-        if (d->overlap_w < 0 || d->overlap_h < 0) {
+        if (overlap_w < 0 || overlap_h < 0) {
             return set_error("\"overlap\" must be non-negative");
         }
     } else {
-        d->overlap_w = 0;
-        d->overlap_h = 0;
+        overlap_w = 0;
+        overlap_h = 0;
+    }
+
+    bool auto_overlap = !!vsapi->propGetInt(in, "auto_overlap", 0, &error);
+    if (error) {
+        auto_overlap = false;
+    }
+    if (auto_overlap && !error1) {
+        return set_error("\"overlap\" and \"auto_overlap\" are mutually exclusive");
     }
 
     size_t tile_w = static_cast<size_t>(vsapi->propGetInt(in, "tilesize", 0, &error1));
@@ -597,7 +918,7 @@ static void VS_CC vsOvCreate(
             tile_h = tile_w;
         }
     } else {
-        if (d->overlap_w != 0 || d->overlap_h != 0) {
+        if (overlap_w != 0 || overlap_h != 0 || auto_overlap) {
             return set_error("\"tilesize\" must be specified");
         }
 
@@ -605,20 +926,217 @@ static void VS_CC vsOvCreate(
         tile_w = in_vis.front()->width;
         tile_h = in_vis.front()->height;
     }
-    if (tile_w - 2 * d->overlap_w <= 0 || tile_h - 2 * d->overlap_h <= 0) {
+    if (tile_w - 2 * overlap_w <= 0 || tile_h - 2 * overlap_h <= 0) {
         return set_error("\"overlap\" too large");
     }
 
+    int batch = int64ToIntS(vsapi->propGetInt(in, "batch", 0, &error));
+    if (error) {
+        batch = 1;
+    }
+    if (batch <= 0) {
+        return set_error("\"batch\" must be positive");
+    }
+
+    int edge_alignment = int64ToIntS(vsapi->propGetInt(in, "edge_alignment", 0, &error));
+    if (error) {
+        edge_alignment = 0;
+    }
+    if (edge_alignment < 0) {
+        return set_error("\"edge_alignment\" must be non-negative");
+    }
+
+    Padding padding = Padding::None;
+    if (const char * mode = vsapi->propGetData(in, "padding", 0, &error); !error) {
+        if (auto result = parsePadding(mode); result.has_value()) {
+            padding = result.value();
+        } else {
+            return set_error("unknown padding "s + mode);
+        }
+    }
+
+    Blend blend = Blend::None;
+    if (const char * mode = vsapi->propGetData(in, "blend", 0, &error); !error) {
+        if (auto result = parseBlend(mode); result.has_value()) {
+            blend = result.value();
+        } else {
+            return set_error("unknown blend "s + mode);
+        }
+    }
+
+    d->pipeline = !!vsapi->propGetInt(in, "pipeline", 0, &error);
+    if (error) {
+        d->pipeline = false;
+    }
+
+    int dedup = int64ToIntS(vsapi->propGetInt(in, "dedup", 0, &error));
+    if (error) {
+        dedup = 0;
+    }
+    if (dedup < 0) {
+        return set_error("\"dedup\" must be non-negative");
+    }
+
+    float dedup_threshold = static_cast<float>(vsapi->propGetFloat(in, "dedup_threshold", 0, &error));
+    if (error) {
+        dedup_threshold = 0.f;
+    }
+    if (!(dedup_threshold >= 0.f)) {
+        return set_error("\"dedup_threshold\" must be non-negative");
+    }
+
+    if (dedup > 0) {
+        d->deduplicator = std::make_unique<FrameDeduplicator>();
+        d->deduplicator->capacity = dedup;
+        d->deduplicator->threshold = dedup_threshold;
+    }
+
+    bool tile_cache = !!vsapi->propGetInt(in, "tile_cache", 0, &error);
+    if (error) {
+        tile_cache = false;
+    }
+
+    float tile_cache_threshold = static_cast<float>(vsapi->propGetFloat(in, "tile_cache_threshold", 0, &error));
+    if (error) {
+        tile_cache_threshold = 0.f;
+    }
+    if (!(tile_cache_threshold >= 0.f)) {
+        return set_error("\"tile_cache_threshold\" must be non-negative");
+    }
+
+    if (tile_cache && blend != Blend::None) {
+        return set_error("\"tile_cache\" and \"blend\" are mutually exclusive");
+    }
+
+    if (tile_cache) {
+        d->tile_cache = std::make_unique<TileCache>();
+        d->tile_cache->threshold = tile_cache_threshold;
+    }
+
+    int constant_cache = int64ToIntS(vsapi->propGetInt(in, "constant_cache", 0, &error));
+    if (error) {
+        constant_cache = 0;
+    }
+    if (constant_cache < 0) {
+        return set_error("\"constant_cache\" must be non-negative");
+    }
+
+    if (constant_cache > 0) {
+        d->constant_cache = std::make_unique<ConstantTileCache>();
+        d->constant_cache->capacity = constant_cache;
+    }
+
+    d->mask_node = vsapi->propGetNode(in, "mask", 0, &error);
+    if (error) {
+        d->mask_node = nullptr;
+    }
+
+    if (int num_roi = vsapi->propNumElements(in, "roi"); num_roi != -1) {
+        if (d->mask_node) {
+            return set_error("\"roi\" and \"mask\" are mutually exclusive");
+        }
+        if (num_roi != 4) {
+            return set_error("\"roi\" must be [left, top, width, height]");
+        }
+
+        d->roi = std::make_unique<RegionOfInterest>();
+        d->roi->left = int64ToIntS(vsapi->propGetInt(in, "roi", 0, nullptr));
+        d->roi->top = int64ToIntS(vsapi->propGetInt(in, "roi", 1, nullptr));
+        d->roi->width = int64ToIntS(vsapi->propGetInt(in, "roi", 2, nullptr));
+        d->roi->height = int64ToIntS(vsapi->propGetInt(in, "roi", 3, nullptr));
+
+        if (d->roi->left < 0 || d->roi->top < 0 || d->roi->width <= 0 || d->roi->height <= 0 ||
+            d->roi->left + d->roi->width > in_vis.front()->width ||
+            d->roi->top + d->roi->height > in_vis.front()->height
+        ) {
+            return set_error("\"roi\" must be a non-empty rectangle inside the clip");
+        }
+    } else if (d->mask_node) {
+        const VSVideoInfo * mask_vi = vsapi->getVideoInfo(d->mask_node);
+        if (!mask_vi->format || mask_vi->format->colorFamily != cmGray ||
+            (mask_vi->format->sampleType == stInteger && mask_vi->format->bitsPerSample > 16) ||
+            mask_vi->width != in_vis.front()->width || mask_vi->height != in_vis.front()->height
+        ) {
+            return set_error("\"mask\" must be a GRAY clip of the same dimensions as the input clips");
+        }
+
+        d->roi = std::make_unique<RegionOfInterest>();
+        d->roi->mask_format = getSampleFormat(mask_vi->format);
+    }
+
+    if (d->roi && blend != Blend::None) {
+        return set_error("\"roi\" and \"blend\" are mutually exclusive");
+    }
+
+    // the output of a duplicate frame depends on its mask
+    if (d->mask_node && d->deduplicator) {
+        return set_error("\"mask\" and \"dedup\" are mutually exclusive");
+    }
+
+    if (auto err = parseScalars(in, d->scalars, d->scalar_props, vsapi); err.has_value()) {
+        return set_error(err.value());
+    }
+
+    // the output of a cached frame or tile depends on the properties
+    if (!std::empty(d->scalar_props) &&
+        (d->deduplicator || d->tile_cache || d->constant_cache)
+    ) {
+        return set_error("\"scalar_props\" is not supported by \"dedup\", \"tile_cache\" and \"constant_cache\"");
+    }
+
+    // these read the source of tiles from the clips directly
+    if (prescale > 1 && (d->roi || d->tile_cache || d->constant_cache)) {
+        return set_error("\"prescale\" is not supported by \"roi\", \"mask\", \"tile_cache\" and \"constant_cache\"");
+    }
+
     bool fp16 = !!vsapi->propGetInt(in, "fp16", 0, &error);
     if (error) {
         fp16 = false;
     }
 
+    bool fp16_io = !!vsapi->propGetInt(in, "fp16_io", 0, &error);
+    if (error) {
+        fp16_io = false;
+    }
+
+    bool half_clips = (
+        in_vis.front()->format->sampleType == stFloat &&
+        in_vis.front()->format->bitsPerSample == 16
+    );
+    if (half_clips && !fp16_io) {
+        return set_error("fp16 clips require \"fp16_io\"");
+    }
+
+    const auto precision = fp16_io ? InferenceEngine::Precision::FP16 : InferenceEngine::Precision::FP32;
+    const int tensor_bytes = fp16_io ? sizeof(uint16_t) : sizeof(float);
+
+    bool quantize = !!vsapi->propGetInt(in, "quantize", 0, &error);
+    if (error) {
+        quantize = false;
+    }
+    if (quantize && in_vis.front()->format->sampleType != stInteger) {
+        return set_error("\"quantize\" requires integer input clips");
+    }
+    if (blend != Blend::None && (quantize || half_clips)) {
+        return set_error("\"blend\" requires 32-bit float output clips");
+    }
+
     bool path_is_serialization = !!vsapi->propGetInt(in, "path_is_serialization", 0, &error);
     if (error) {
         path_is_serialization = false;
     }
 
+    std::filesystem::path model_cache;
+    if (const char * directory = vsapi->propGetData(in, "model_cache", 0, &error); !error) {
+        model_cache = std::filesystem::u8path(directory);
+
+        std::error_code ec;
+        std::filesystem::create_directories(model_cache, ec);
+        if (ec) {
+            return set_error("\"model_cache\": " + ec.message());
+        }
+    }
+
     std::string_view path_view;
     std::string path;
     if (path_is_serialization) {
@@ -640,23 +1158,121 @@ static void VS_CC vsOvCreate(
         path_view = path;
     }
 
-    auto result = loadONNX(path_view, tile_w, tile_h, path_is_serialization);
-    if (std::holds_alternative<std::string>(result)) {
-        return set_error(std::get<std::string>(result));
+    // preprocessed networks are cached by the contents of the source
+    MappedFile network_file;
+    if (!std::empty(model_cache) && !path_is_serialization) {
+        if (!network_file.open(std::filesystem::u8path(path))) {
+            return set_error("open "s + path + " failed"s);
+        }
+        path_view = network_file.data();
+        path_is_serialization = true;
+    }
+
+    std::string source_digest;
+    if (!std::empty(model_cache)) {
+        source_digest = sourceDigest(path_view);
     }
 
-    auto onnx_model = std::move(std::get<ONNX_NAMESPACE::ModelProto>(result));
+    if (auto_overlap) {
+        std::filesystem::path overlap_path;
+        std::optional<std::array<int, 2>> overlap;
+        if (!std::empty(model_cache)) {
+            overlap_path = overlapPath(model_cache, source_digest, tile_w, tile_h, VERSION);
+            overlap = loadOverlap(overlap_path);
+        }
+
+        if (!overlap.has_value()) {
+            auto result = loadONNX(path_view, tile_w, tile_h, 1, path_is_serialization);
+            if (std::holds_alternative<std::string>(result)) {
+                return set_error(std::get<std::string>(result));
+            }
+
+            auto derived = receptiveFieldOverlap(std::get<ONNX_NAMESPACE::ModelProto>(result));
+            if (std::holds_alternative<std::string>(derived)) {
+                return set_error("\"auto_overlap\": " + std::get<std::string>(derived));
+            }
+            overlap = std::get<std::array<int, 2>>(derived);
+
+            if (!std::empty(model_cache)) {
+                storeOverlap(overlap_path, overlap.value());
+            }
+        }
+        overlap_w = overlap.value()[0];
+        overlap_h = overlap.value()[1];
+
+        if (static_cast<int>(tile_w) - 2 * overlap_w <= 0 || static_cast<int>(tile_h) - 2 * overlap_h <= 0) {
+            return set_error(
+                "\"tilesize\" too small for the receptive field (" +
+                std::to_string(overlap_w) + ", " + std::to_string(overlap_h) + ")"
+            );
+        }
 
-    if (fp16) {
-        convert_float_to_float16(onnx_model, false);
+        auto message = (
+            "ov.Model: overlap set to (" + std::to_string(overlap_w) + ", " +
+            std::to_string(overlap_h) + ")"
+        );
+        vsapi->logMessage(mtDebug, message.c_str());
     }
 
-    std::string onnx_data = onnx_model.SerializeAsString();
-    if (std::size(onnx_data) == 0) {
-        return set_error("proto serialization failed");
+    // there is no point in batching more tiles than a frame has
+    batch = std::min(batch, numTiles(
+        in_vis.front()->width, in_vis.front()->height,
+        static_cast<int>(tile_w), static_cast<int>(tile_h),
+        overlap_w, overlap_h
+    ));
+
+    // shrunk edge tiles require a network of their own
+    const auto shapes = tileShapes(
+        in_vis.front()->width, in_vis.front()->height,
+        static_cast<int>(tile_w), static_cast<int>(tile_h),
+        overlap_w, overlap_h, batch, edge_alignment
+    );
+
+    auto config_func = vsapi->propGetFunc(in, "config", 0, &error);
+    auto config_ret = getConfig(config_func, core, vsapi);
+    vsapi->freeFunc(config_func);
+    if (std::holds_alternative<std::string>(config_ret)) {
+        return set_error(std::get<std::string>(config_ret));
     }
+    auto & config = std::get<std::map<std::string, std::string>>(config_ret);
+
+    for (const auto & shape : shapes) {
+        std::string onnx_data;
+
+        std::filesystem::path cache_path;
+        if (!std::empty(model_cache)) {
+            cache_path = preprocessedModelPath(
+                model_cache, source_digest, shape.tile_w, shape.tile_h, shape.batch,
+                fp16, fp16_io, VERSION
+            );
+
+            if (MappedFile cached; cached.open(cache_path)) {
+                onnx_data = cached.data();
+            }
+        }
+
+        if (std::empty(onnx_data)) {
+            auto result = loadONNX(path_view, shape.tile_w, shape.tile_h, shape.batch, path_is_serialization);
+            if (std::holds_alternative<std::string>(result)) {
+                return set_error(std::get<std::string>(result));
+            }
+
+            auto onnx_model = std::move(std::get<ONNX_NAMESPACE::ModelProto>(result));
+
+            if (fp16) {
+                convert_float_to_float16(onnx_model, false, !fp16_io);
+            }
+
+            onnx_data = onnx_model.SerializeAsString();
+            if (std::size(onnx_data) == 0) {
+                return set_error("proto serialization failed");
+            }
+
+            if (!std::empty(model_cache)) {
+                storeEntry(cache_path, onnx_data);
+            }
+        }
 
-    {
         InferenceEngine::CNNNetwork network;
         try {
             auto empty = InferenceEngine::Blob::CPtr();
@@ -667,7 +1283,17 @@ static void VS_CC vsOvCreate(
             return set_error("[Standard exception] ReadNetwork(): "s + e.what());
         }
 
-        if (auto err = checkNetwork(network); err.has_value()) {
+        // fp32 networks are fed with fp16 blobs converted by the device plugin
+        if (fp16_io) {
+            for (const auto & [_, info] : network.getInputsInfo()) {
+                info->setPrecision(precision);
+            }
+            for (const auto & [_, info] : network.getOutputsInfo()) {
+                info->setPrecision(precision);
+            }
+        }
+
+        if (auto err = checkNetwork(network, shape.batch, precision); err.has_value()) {
             return set_error(err.value());
         }
 
@@ -681,7 +1307,7 @@ static void VS_CC vsOvCreate(
 
 #ifdef ENABLE_VISUALIZATION
         const char * dot_path = vsapi->propGetData(in, "dot_path", 0, &error);
-        if (!error) {
+        if (!error && std::empty(d->executable_networks)) {
             try {
                 ov::pass::VisualizeTree(dot_path, nullptr, true).run_on_function(function);
             } catch (const ov::Exception & e) {
@@ -690,28 +1316,68 @@ static void VS_CC vsOvCreate(
         }
 #endif // ENABLE_VISUALIZATION
 
-        auto config_func = vsapi->propGetFunc(in, "config", 0, &error);
-        auto config_ret = getConfig(config_func, core, vsapi);
-        vsapi->freeFunc(config_func);
-        if (std::holds_alternative<std::string>(config_ret)) {
-            return set_error(std::get<std::string>(config_ret));
-        }
-        auto & config = std::get<std::map<std::string, std::string>>(config_ret);
-
         try {
-            d->executable_network = d->core.LoadNetwork(network, device, config);
+            d->executable_networks.push_back(d->core.LoadNetwork(network, device, config));
         } catch (const InferenceEngine::Exception & e) {
             return set_error(e.what());
         }
 
-        if (auto err = checkNodesAndNetwork(d->executable_network, in_vis); err.has_value()) {
+        if (auto err = checkNodesAndNetwork(
+            d->executable_networks.back(), in_vis,
+            static_cast<int>(std::size(d->scalars)), padding != Padding::None
+        ); err.has_value()) {
             return set_error(err.value());
         }
+    }
+
+    {
+        const auto & executable_network = d->executable_networks[0];
+
+        setDimensions(d->out_vi, executable_network, core, vsapi);
+
+        if (quantize) {
+            d->out_vi->format = vsapi->registerFormat(
+                d->out_vi->format->colorFamily, stInteger,
+                in_vis.front()->format->bitsPerSample, 0, 0, core
+            );
+        } else if (half_clips) {
+            d->out_vi->format = vsapi->registerFormat(
+                d->out_vi->format->colorFamily, stFloat, 16, 0, 0, core
+            );
+        }
+
+        {
+            auto src_tile_shape = getShape(executable_network, true);
+            auto dst_tile_shape = getShape(executable_network, false);
+
+            d->plan = makeTilePlan(
+                in_vis.front()->width, in_vis.front()->height,
+                src_tile_shape[1] - static_cast<int>(std::size(d->scalars)),
+                getSampleFormat(in_vis.front()->format),
+                dst_tile_shape[1], getSampleFormat(d->out_vi->format),
+                src_tile_shape[3], src_tile_shape[2],
+                overlap_w, overlap_h,
+                dst_tile_shape[3] / src_tile_shape[3],
+                dst_tile_shape[2] / src_tile_shape[2],
+                batch, tensor_bytes, edge_alignment, padding, blend,
+                static_cast<int>(std::size(d->scalars)), prescale
+            );
+        }
 
-        setDimensions(d->out_vi, d->executable_network, core, vsapi);
+        if (d->roi && d->plan.src_planes != d->plan.dst_planes) {
+            return set_error("\"roi\" and \"mask\" require as many output planes as input planes");
+        }
+
+        if (d->plan.saved_pixels > 0) {
+            auto message = (
+                "ov.Model: edge tiles save "s + std::to_string(d->plan.saved_pixels) +
+                " input pixels per plane and frame"
+            );
+            vsapi->logMessage(mtDebug, message.c_str());
+        }
 
-        d->input_name = d->executable_network.GetInputsInfo().cbegin()->first;
-        d->output_name = d->executable_network.GetOutputsInfo().cbegin()->first;
+        d->input_name = executable_network.GetInputsInfo().cbegin()->first;
+        d->output_name = executable_network.GetOutputsInfo().cbegin()->first;
 
         VSCoreInfo core_info;
         vsapi->getCoreInfo2(core, &core_info);
@@ -752,6 +1418,25 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit(
 #ifdef ENABLE_VISUALIZATION
         "dot_path:data:opt;"
 #endif
+        "auto_overlap:int:opt;"
+        "batch:int:opt;"
+        "edge_alignment:int:opt;"
+        "padding:data:opt;"
+        "blend:data:opt;"
+        "pipeline:int:opt;"
+        "dedup:int:opt;"
+        "dedup_threshold:float:opt;"
+        "tile_cache:int:opt;"
+        "tile_cache_threshold:float:opt;"
+        "constant_cache:int:opt;"
+        "roi:int[]:opt;"
+        "mask:clip:opt;"
+        "scalars:float[]:opt;"
+        "scalar_props:data[]:opt;"
+        "prescale:int:opt;"
+        "quantize:int:opt;"
+        "fp16_io:int:opt;"
+        "model_cache:data:opt;"
         , vsOvCreate,
         nullptr,
         plugin
@@ -115,7 +115,8 @@ int numPlanes(
 static inline
 std::optional<std::string> checkNodesAndContext(
     const std::unique_ptr<nvinfer1::IExecutionContext> & execution_context,
-    const std::vector<const VSVideoInfo *> & vis
+    const std::vector<const VSVideoInfo *> & vis,
+    bool padding
 ) noexcept {
 
     const nvinfer1::Dims & network_in_dims = execution_context->getBindingDimensions(0);
@@ -131,7 +132,7 @@ std::optional<std::string> checkNodesAndContext(
     int clip_in_height = vis[0]->height;
     int clip_in_width = vis[0]->width;
 
-    if (network_in_height > clip_in_height || network_in_width > clip_in_width) {
+    if (!padding && (network_in_height > clip_in_height || network_in_width > clip_in_width)) {
         return "tile size larger than clip dimension";
     }
 
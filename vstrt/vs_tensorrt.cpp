@@ -71,7 +71,7 @@ struct vsTrtData {
     int device_id;
     int num_streams;
     bool use_cuda_graph;
-    int overlap_w, overlap_h;
+    TilePlan plan;
 
     Logger logger;
     std::unique_ptr<nvinfer1::IRuntime> runtime;
@@ -141,10 +141,8 @@ static const VSFrameRef *VS_CC vsTrtGetFrame(
             getFrames(n, vsapi, frameCtx, d->nodes)
         };
 
-        const int src_planes { d->engines[0]->getBindingDimensions(0).d[1] };
-
         std::vector<const uint8_t *> src_ptrs;
-        src_ptrs.reserve(src_planes);
+        src_ptrs.reserve(d->plan.src_planes);
         for (int i = 0; i < std::ssize(d->nodes); ++i) {
             for (int j = 0; j < in_vis[i]->format->numPlanes; ++j) {
                 src_ptrs.emplace_back(vsapi->getReadPtr(src_frames[i], j));
@@ -156,50 +154,21 @@ static const VSFrameRef *VS_CC vsTrtGetFrame(
             src_frames[0], core
         )};
 
-        const int dst_planes { d->engines[0]->getBindingDimensions(1).d[1] };
         std::vector<uint8_t *> dst_ptrs;
-        dst_ptrs.reserve(dst_planes);
-        for (int i = 0; i < dst_planes; ++i) {
+        dst_ptrs.reserve(d->plan.dst_planes);
+        for (int i = 0; i < d->plan.dst_planes; ++i) {
             dst_ptrs.emplace_back(vsapi->getWritePtr(dst_frame, i));
         }
 
         const int ticket { d->acquire() };
         InferenceInstance & instance { d->instances[ticket] };
 
-        const nvinfer1::Dims src_dim { instance.exec_context->getBindingDimensions(0) };
-        const int src_tile_h { src_dim.d[2] };
-        const int src_tile_w { src_dim.d[3] };
-
-        const nvinfer1::Dims dst_dim { instance.exec_context->getBindingDimensions(1) };
-        const int dst_tile_h { dst_dim.d[2] };
-        const int dst_tile_w { dst_dim.d[3] };
-
-        const int h_scale = dst_tile_h / src_tile_h;
-        const int w_scale = dst_tile_w / src_tile_w;
-
-        const IOInfo info {
-            .in = InputInfo {
-                .width = vsapi->getFrameWidth(src_frames[0], 0),
-                .height = vsapi->getFrameHeight(src_frames[0], 0),
-                .pitch = vsapi->getStride(src_frames[0], 0),
-                .bytes_per_sample = vsapi->getFrameFormat(src_frames[0])->bytesPerSample,
-                .tile_w = src_tile_w,
-                .tile_h = src_tile_h
-            },
-            .out = OutputInfo {
-                .pitch = vsapi->getStride(dst_frame, 0),
-                .bytes_per_sample = vsapi->getFrameFormat(dst_frame)->bytesPerSample
-            },
-            .w_scale = w_scale,
-            .h_scale = h_scale,
-            .overlap_w = d->overlap_w,
-            .overlap_h = d->overlap_h
-        };
-
         const auto inference_result = inference(
             instance,
             d->device_id, d->use_cuda_graph,
-            info, src_ptrs, dst_ptrs
+            d->plan,
+            src_ptrs, vsapi->getStride(src_frames[0], 0),
+            dst_ptrs, vsapi->getStride(dst_frame, 0)
         );
 
         d->release(ticket);
@@ -274,19 +243,19 @@ static void VS_CC vsTrtCreate(
     int error;
 
     int error1, error2;
-    d->overlap_w = int64ToIntS(vsapi->propGetInt(in, "overlap", 0, &error1));
-    d->overlap_h = int64ToIntS(vsapi->propGetInt(in, "overlap", 1, &error2));
+    int overlap_w = int64ToIntS(vsapi->propGetInt(in, "overlap", 0, &error1));
+    int overlap_h = int64ToIntS(vsapi->propGetInt(in, "overlap", 1, &error2));
     if (!error1) {
         if (error2) {
-            d->overlap_h = d->overlap_w;
+            overlap_h = overlap_w;
         }
 
-        if (d->overlap_w < 0 || d->overlap_h < 0) {
+        if (overlap_w < 0 || overlap_h < 0) {
             return set_error("\"overlap\" must be non-negative");
         }
     } else {
-        d->overlap_w = 0;
-        d->overlap_h = 0;
+        overlap_w = 0;
+        overlap_h = 0;
     }
 
     int tile_w = int64ToIntS(vsapi->propGetInt(in, "tilesize", 0, &error1));
@@ -298,7 +267,7 @@ static void VS_CC vsTrtCreate(
             tile_h = tile_w;
         }
 
-        if (tile_w - 2 * d->overlap_w <= 0 || tile_h - 2 * d->overlap_h <= 0) {
+        if (tile_w - 2 * overlap_w <= 0 || tile_h - 2 * overlap_h <= 0) {
             return set_error("\"overlap\" too large");
         }
 
@@ -307,14 +276,14 @@ static void VS_CC vsTrtCreate(
             .tile_h = tile_h
         };
     } else {
-        if (d->overlap_w != 0 || d->overlap_h != 0) {
+        if (overlap_w != 0 || overlap_h != 0) {
             return set_error("\"tilesize\" must be specified");
         }
 
         int width = in_vis[0]->width;
         int height = in_vis[0]->height;
 
-        if (width - 2 * d->overlap_w <= 0 || height - 2 * d->overlap_h <= 0) {
+        if (width - 2 * overlap_w <= 0 || height - 2 * overlap_h <= 0) {
             return set_error("\"overlap\" too large");
         }
 
@@ -324,6 +293,24 @@ static void VS_CC vsTrtCreate(
         };
     }
 
+    Padding padding = Padding::None;
+    if (const char * mode = vsapi->propGetData(in, "padding", 0, &error); !error) {
+        if (auto result = parsePadding(mode); result.has_value()) {
+            padding = result.value();
+        } else {
+            return set_error("unknown padding "s + mode);
+        }
+    }
+
+    Blend blend = Blend::None;
+    if (const char * mode = vsapi->propGetData(in, "blend", 0, &error); !error) {
+        if (auto result = parseBlend(mode); result.has_value()) {
+            blend = result.value();
+        } else {
+            return set_error("unknown blend "s + mode);
+        }
+    }
+
     int device_id = int64ToIntS(vsapi->propGetInt(in, "device_id", 0, &error));
     if (error) {
         device_id = 0;
@@ -413,7 +400,7 @@ static void VS_CC vsTrtCreate(
 
         if (std::holds_alternative<InferenceInstance>(maybe_instance)) {
             auto instance = std::move(std::get<InferenceInstance>(maybe_instance));
-            if (auto err = checkNodesAndContext(instance.exec_context, in_vis); err.has_value()) {
+            if (auto err = checkNodesAndContext(instance.exec_context, in_vis, padding != Padding::None); err.has_value()) {
                 return set_error(err.value());
             }
             d->instances.emplace_back(std::move(instance));
@@ -431,6 +418,23 @@ static void VS_CC vsTrtCreate(
     d->out_vi = std::make_unique<VSVideoInfo>(*in_vis[0]);
     setDimensions(d->out_vi, d->instances[0].exec_context, core, vsapi);
 
+    {
+        const auto & exec_context = d->instances[0].exec_context;
+        const nvinfer1::Dims src_dim { exec_context->getBindingDimensions(0) };
+        const nvinfer1::Dims dst_dim { exec_context->getBindingDimensions(1) };
+
+        d->plan = makeTilePlan(
+            in_vis[0]->width, in_vis[0]->height,
+            src_dim.d[1], getSampleFormat(in_vis[0]->format),
+            dst_dim.d[1], getSampleFormat(d->out_vi->format),
+            src_dim.d[3], src_dim.d[2],
+            overlap_w, overlap_h,
+            dst_dim.d[3] / src_dim.d[3],
+            dst_dim.d[2] / src_dim.d[2],
+            1, sizeof(float), 0, padding, blend
+        );
+    }
+
     vsapi->createFilter(
         in, out, "Model",
         vsTrtInit, vsTrtGetFrame, vsTrtFree,
@@ -459,7 +463,9 @@ VS_EXTERNAL_API(void) VapourSynthPluginInit(
         "device_id:int:opt;"
         "use_cuda_graph:int:opt;"
         "num_streams:int:opt;"
-        "verbosity:int:opt;",
+        "verbosity:int:opt;"
+        "padding:data:opt;"
+        "blend:data:opt;",
         vsTrtCreate,
         nullptr,
         plugin